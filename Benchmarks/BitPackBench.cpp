@@ -0,0 +1,135 @@
+/*
+ * BitPackBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Host-side throughput of the bulk bit-packing kernels (BitPack.hpp) against a field-at-a-time packer with the width known only
+ * at run time, like the generic Packer/Unpacker path. For each field width, packs N random values into 1024b lines and unpacks
+ * them again, checks both directions bit-exact against the reference, and reports the best of reps in millions of fields/s and
+ * GB/s of packed lines. Needs no AFU.
+ *
+ * Usage: bench_bitpack [N [reps]]
+ */
+
+#include <BlueLink/Host/BitPack.hpp>
+
+#include <boost/align/aligned_allocator.hpp>
+
+#include <boost/random/mersenne_twister.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+typedef vector<uint64_t,boost::alignment::aligned_allocator<uint64_t,128>> Buffer;
+
+/// Reference packer: one field at a time, one bit at a time, runtime width (same layout as BitPackLayout)
+void refPack(const uint64_t* src,std::size_t n,unsigned bits,unsigned lineBits,uint64_t* dst)
+{
+	const unsigned perLine = lineBits/bits;
+	memset(dst,0,(n+perLine-1)/perLine*lineBits/8);
+
+	for(std::size_t i=0;i<n;++i)
+	{
+		const std::size_t base = i/perLine*lineBits + i%perLine*bits;
+		for(unsigned b=0;b<bits;++b)
+			dst[(base+b)/64] |= ((src[i] >> b) & 1) << ((base+b)%64);
+	}
+}
+
+void refUnpack(const uint64_t* src,std::size_t n,unsigned bits,unsigned lineBits,uint64_t* dst)
+{
+	const unsigned perLine = lineBits/bits;
+
+	for(std::size_t i=0;i<n;++i)
+	{
+		const std::size_t base = i/perLine*lineBits + i%perLine*bits;
+		uint64_t x=0;
+		for(unsigned b=0;b<bits;++b)
+			x |= ((src[(base+b)/64] >> ((base+b)%64)) & 1) << b;
+		dst[i]=x;
+	}
+}
+
+/// Best time of reps calls to f
+double bestSeconds(unsigned reps,const std::function<void()>& f)
+{
+	double best=0.0;
+	for(unsigned r=0;r<reps;++r)
+	{
+		auto t0 = chrono::steady_clock::now();
+		f();
+		const double t = chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+		best = r == 0 ? t : std::min(best,t);
+	}
+	return best;
+}
+
+template<unsigned Bits>bool bench(std::size_t N,unsigned reps)
+{
+	typedef BitPackLayout<Bits> L;
+
+	boost::random::mt19937_64 rng(Bits);
+	Buffer values(N), ref(N), out(N);
+	for(auto& v : values)
+		v = rng() & L::mask;
+
+	const std::size_t lineWords = L::lines(N)*L::lineWords;
+	Buffer packed(lineWords), refPacked(lineWords);
+
+	const double tRefPack = bestSeconds(1,[&]{ refPack(values.data(),N,Bits,1024,refPacked.data()); });
+	const double tRefUnpack = bestSeconds(1,[&]{ refUnpack(refPacked.data(),N,Bits,1024,ref.data()); });
+
+	const double tPack = bestSeconds(reps,[&]{ bitpack_lines<Bits>(values.data(),N,packed.data()); });
+	const double tUnpack = bestSeconds(reps,[&]{ bitunpack_lines<Bits>(packed.data(),N,out.data()); });
+
+	const bool ok = packed == refPacked && out == values && ref == values;
+
+	auto rate = [N](double t){ return N/t*1e-6; };
+	const double lineGB = lineWords*8*1e-9;
+
+	cout << setw(4) << Bits << setw(6) << L::perLine <<
+		setw(12) << rate(tPack) << setw(10) << lineGB/tPack << setw(12) << rate(tUnpack) << setw(10) << lineGB/tUnpack <<
+		setw(12) << rate(tRefPack) << setw(12) << rate(tRefUnpack) << (ok ? "" : "  MISMATCH") << endl;
+
+	return ok;
+}
+
+int main(int argc,char **argv)
+{
+	const std::size_t N = argc > 1 ? strtoull(argv[1],nullptr,0) : std::size_t(1)<<22;
+	const unsigned reps = argc > 2 ? atoi(argv[2]) : 5;
+
+#if defined(__AVX512F__)
+	cout << "Unpack kernel: AVX-512F" << endl;
+#elif defined(__AVX2__)
+	cout << "Unpack kernel: AVX2" << endl;
+#else
+	cout << "Unpack kernel: scalar" << endl;
+#endif
+	cout << N << " fields, best of " << reps << "; rates in Mfield/s and GB/s of packed lines" << endl;
+	cout << "bits  /ln   pack Mf/s  pack GB/s unpack Mf/s unp. GB/s   ref pack  ref unpack" << endl;
+	cout << fixed << setprecision(1);
+
+	bool ok=true;
+	ok &= bench<8>(N,reps);
+	ok &= bench<13>(N,reps);
+	ok &= bench<16>(N,reps);
+	ok &= bench<31>(N,reps);
+	ok &= bench<32>(N,reps);
+	ok &= bench<48>(N,reps);
+	ok &= bench<57>(N,reps);
+	ok &= bench<62>(N,reps);
+	ok &= bench<64>(N,reps);
+
+	if (!ok)
+		cout << "ERROR: bulk kernels disagree with the reference" << endl;
+
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,70 @@
+/*
+ * MMIOBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Microbenchmark for the host MMIO paths. Attaches to an AFU following the BlockMapAFU status protocol (blank WED, never started)
+ * and reports the mean time per 64b register access for:
+ *
+ *      mmio_read64                 libcxl call with handle check and error printing
+ *      mmio_read64_fast<true>      inline read from the direct mapping with endian swap
+ *      mmio_read64_fast<false>     inline read from the direct mapping, raw (no swap)
+ *      mmio_read_block             one call reading 8 contiguous registers (reported per register)
+ *
+ * Usage: bench_mmio [device [N]]
+ */
+
+#include <BlueLink/Host/AFU.hpp>
+#include <BlueLink/Host/WED.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+
+using namespace std;
+
+struct BlankWED
+{
+	uint64_t pad[16];
+};
+
+/// Runs f N times and returns the mean ns per call divided by accessesPerCall
+double nsPerAccess(std::size_t N,unsigned accessesPerCall,const std::function<void()>& f)
+{
+	auto t0 = chrono::steady_clock::now();
+	for(std::size_t i=0;i<N;++i)
+		f();
+	auto t1 = chrono::steady_clock::now();
+	return chrono::duration<double,std::nano>(t1-t0).count() / double(N*accessesPerCall);
+}
+
+int main(int argc,char **argv)
+{
+	const string devstr = argc > 1 ? argv[1] : "/dev/cxl/afu0.0d";
+	const std::size_t N = argc > 2 ? atoi(argv[2]) : 100000;
+
+	StackWED<BlankWED,128,128> wed;
+
+	AFU afu(devstr);
+	afu.start(wed);
+
+	cout << "Direct MMIO mapping " << (afu.mmio_fast_available() ? "available" : "NOT available (fast path falls back to libcxl)") << endl;
+
+	volatile uint64_t sink=0;			// keep the compiler from discarding reads
+	uint64_t block[8];
+
+	double tLib  = nsPerAccess(N,1,[&]{ sink += afu.mmio_read64(0); });
+	double tFast = nsPerAccess(N,1,[&]{ sink += afu.mmio_read64_fast<true>(0); });
+	double tRaw  = nsPerAccess(N,1,[&]{ sink += afu.mmio_read64_fast<false>(0); });
+	double tBlk  = nsPerAccess(N,8,[&]{ afu.mmio_read_block(0,8,block); sink += block[0]; });
+
+	cout << fixed << setprecision(1);
+	cout << "Accesses per path: " << N << endl;
+	cout << "  mmio_read64              " << setw(10) << tLib  << " ns/access" << endl;
+	cout << "  mmio_read64_fast<true>   " << setw(10) << tFast << " ns/access" << endl;
+	cout << "  mmio_read64_fast<false>  " << setw(10) << tRaw  << " ns/access" << endl;
+	cout << "  mmio_read_block (8)      " << setw(10) << tBlk  << " ns/access" << endl;
+
+	return 0;
+}
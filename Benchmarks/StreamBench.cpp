@@ -0,0 +1,386 @@
+/*
+ * StreamBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Bandwidth/latency sweep over the streaming AFUs. For every combination of transfer size, buffer alignment, page backing and
+ * read:write mix, the buffers are allocated once and the job is repeated (fresh attach each time, after warmup runs). Each run
+ * is timed from the start MMIO write to Done status, and separately from attach to Waiting status. Results go to the console and
+ * as JSON (one record per configuration) with mean/stddev/95% confidence interval of throughput (bytes read plus bytes written)
+ * and percentiles of latency. Throughput is averaged over the per-run rates; readGBps and writeGBps split that mean in the
+ * read:write byte ratio, so they always sum to it. The exit status is nonzero if any run failed or any copy mismatched.
+ *
+ * AFUs:
+ *      memcopy             Examples/Memcopy or Examples/MemcopyStream (WED: source, destination, size); copies are checked
+ *      blockmap            mkBlockMapAFU-based (BlockMapAFUBase); the read:write mix sets the input and output sizes, which the
+ *                          mapper must accept (the emulator's copy map accepts any)
+ *
+ * The device string is passed straight to AFU, so the same command runs against hardware (/dev/cxl/afu0.0d), PSLSE simulation
+ * or the emulators (emu:memcopy, emu:blockmap[:<args>]).
+ *
+ * Usage: bench_stream [key=value]...
+ *      dev=<devstr>        device (default /dev/cxl/afu0.0d)
+ *      afu=memcopy|blockmap                                        (default memcopy)
+ *      size=<bytes>,...    transfer size, larger side for mixes (default 64k,1M,16M,256M; k/M/G suffixes)
+ *      align=<bytes>,...   buffer alignment: a multiple of 128, buffers are aligned to exactly this (default 128,4k)
+ *      pages=<p>,...       page backing: 4k, thp, 2m, 1g (default 4k,thp)
+ *      mix=<r:w>,...       read:write byte ratio, blockmap only (default 1:1)
+ *      reps=<n>            timed runs per configuration (default 10)
+ *      warmup=<n>          untimed runs per configuration first (default 1)
+ *      wait=spin|backoff|event                                     (default spin)
+ *      timeout=<ms>        per-run timeout (default 10000)
+ *      json=<file>         JSON output (default bench_stream.json)
+ */
+
+#include <BlueLink/Host/AFU.hpp>
+#include <BlueLink/Host/BlockMapAFUBase.hpp>
+#include <BlueLink/Host/WED.hpp>
+#include <BlueLink/Host/WaitPolicy.hpp>
+#include <BlueLink/Host/pinned_allocator.hpp>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct MemcopyWED {
+	uint64_t	addr_from;
+	uint64_t	addr_to;
+	uint64_t	size;
+
+	uint64_t	resv[13];
+};
+
+class BlockMapJob : public BlockMapAFUBase
+{
+public:
+	BlockMapJob(const char* devStr) : BlockMapAFUBase(devStr){}
+
+	void set(const void* src,uint64_t iSize,void* dst,uint64_t oSize)
+	{
+		m_wed->param.src = src;
+		m_wed->param.iSize = iSize;
+		m_wed->param.dst = dst;
+		m_wed->param.oSize = oSize;
+	}
+};
+
+struct Options
+{
+	string					dev="/dev/cxl/afu0.0d";
+	string					afu="memcopy";
+	vector<uint64_t>		sizes{ 64<<10, 1<<20, 16<<20, 256<<20 };
+	vector<uint64_t>		aligns{ 128, 4096 };
+	vector<string>			pages{ "4k", "thp" };
+	vector<string>			mixes{ "1:1" };
+	unsigned				reps=10;
+	unsigned				warmup=1;
+	WaitPolicy::Mode		wait=WaitPolicy::Spin;
+	chrono::milliseconds	timeout{10000};
+	string					json="bench_stream.json";
+};
+
+/// Outcome of one run (negative times on failure)
+struct Run
+{
+	double		attach=-1.0;		// attach to Waiting status, s
+	double		run=-1.0;			// start to Done status, s
+};
+
+namespace {
+
+uint64_t parseBytes(const string& s)
+{
+	char* e=nullptr;
+	uint64_t x = strtoull(s.c_str(),&e,0);
+	switch(e ? *e : 0)
+	{
+	case 'k': case 'K': x <<= 10; break;
+	case 'm': case 'M': x <<= 20; break;
+	case 'g': case 'G': x <<= 30; break;
+	}
+	return x;
+}
+
+vector<string> splitList(const string& s)
+{
+	vector<string> v;
+	boost::split(v,s,boost::is_any_of(","));
+	return v;
+}
+
+PageBacking parsePages(const string& s)
+{
+	static const map<string,PageBacking> m{
+		make_pair("4k",PageBacking::Default),
+		make_pair("thp",PageBacking::TransparentHuge),
+		make_pair("2m",PageBacking::HugeTLB2M),
+		make_pair("1g",PageBacking::HugeTLB1G) };
+	auto it = m.find(s);
+	if (it == m.end())
+		throw std::invalid_argument("unknown page backing '" + s + "'");
+	return it->second;
+}
+
+/// Input and output bytes for a mix "r:w" where the larger side gets size bytes (each rounded down to whole cache lines)
+pair<uint64_t,uint64_t> mixBytes(const string& mix,uint64_t size)
+{
+	unsigned r=1, w=1;
+	if (sscanf(mix.c_str(),"%u:%u",&r,&w) != 2 || (r == 0 && w == 0))
+		throw std::invalid_argument("bad read:write mix '" + mix + "'");
+
+	const unsigned m = max(r,w);
+	return make_pair(size*r/m/128*128,size*w/m/128*128);
+}
+
+/// Nearest-rank percentile of sorted x
+double percentile(const vector<double>& x,double p)
+{
+	if (x.empty())
+		return 0.0;
+	const size_t i = size_t(ceil(p*x.size()));
+	return x[min(x.size()-1,i ? i-1 : 0)];
+}
+
+/// Two-sided 95% Student t quantile for n-1 degrees of freedom
+double t95(size_t n)
+{
+	static const double t[] = { 0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160,
+		2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+	return n < 2 ? 0.0 : n-1 <= 30 ? t[n-1] : 1.960;
+}
+
+void writeStats(ostream& os,const vector<double>& sorted,double scale)
+{
+	const double mean = sorted.empty() ? 0.0 : accumulate(sorted.begin(),sorted.end(),0.0)/sorted.size();
+	os << "{\"min\":" << (sorted.empty() ? 0.0 : sorted.front()*scale) << ",\"p50\":" << percentile(sorted,0.5)*scale <<
+		",\"p90\":" << percentile(sorted,0.9)*scale << ",\"p99\":" << percentile(sorted,0.99)*scale << ",\"max\":" <<
+		(sorted.empty() ? 0.0 : sorted.back()*scale) << ",\"mean\":" << mean*scale << '}';
+}
+
+Run runMemcopy(const Options& o,const void* src,void* dst,uint64_t size)
+{
+	Run r;
+	AFU afu(o.dev);
+
+	StackWED<MemcopyWED,128,128> wed;
+	wed->addr_from = reinterpret_cast<uint64_t>(src);
+	wed->addr_to = reinterpret_cast<uint64_t>(dst);
+	wed->size = size;
+
+	WaitPolicy w(o.wait);
+
+	const auto t0 = chrono::steady_clock::now();
+	afu.start(wed.get());
+	// status is the low byte of MMIO 0x00
+	if (!w.until([&afu]{ return (afu.mmio_read64_fast(0) & 0xff) == BlockMapAFUBase::Waiting; },o.timeout))
+	{
+		cout << "ERROR: Timeout waiting for 'waiting' status" << endl;
+		return r;
+	}
+	const auto t1 = chrono::steady_clock::now();
+
+	afu.mmio_write64_fast(0,BlockMapAFUBase::Start);
+	const bool ok = w.until([&afu]{ return (afu.mmio_read64_fast(0) & 0xff) == BlockMapAFUBase::Done; },o.timeout);	// no completion interrupt
+	const auto t2 = chrono::steady_clock::now();
+	afu.mmio_write64(0,BlockMapAFUBase::Terminate);
+
+	if (!ok)
+		cout << "ERROR: Timeout waiting for done status" << endl;
+	else
+	{
+		r.attach = chrono::duration<double>(t1-t0).count();
+		r.run = chrono::duration<double>(t2-t1).count();
+	}
+	return r;
+}
+
+Run runBlockMap(const Options& o,const void* src,uint64_t iSize,void* dst,uint64_t oSize)
+{
+	Run r;
+	BlockMapJob afu(o.dev.c_str());
+	afu.waitPolicy().mode(o.wait);
+	afu.runTimeout(o.timeout);
+	afu.set(src,iSize,dst,oSize);
+
+	const auto t0 = chrono::steady_clock::now();
+	afu.start();
+	const auto t1 = chrono::steady_clock::now();
+	afu.run();
+	const auto t2 = chrono::steady_clock::now();
+	const bool ok = afu.status() == BlockMapAFUBase::Done;
+	afu.terminate();
+
+	if (ok)
+	{
+		r.attach = chrono::duration<double>(t1-t0).count();
+		r.run = chrono::duration<double>(t2-t1).count();
+	}
+	return r;
+}
+
+}
+
+int main(int argc,char **argv)
+{
+	Options o;
+
+	try {
+		for(int i=1;i<argc;++i)
+		{
+			const string a(argv[i]);
+			const size_t eq = a.find('=');
+			const string k = a.substr(0,eq), v = eq == string::npos ? "" : a.substr(eq+1);
+
+			if (k == "dev")				o.dev = v;
+			else if (k == "afu")		o.afu = v;
+			else if (k == "size")		{ o.sizes.clear(); for(const string& s : splitList(v)) o.sizes.push_back(parseBytes(s)); }
+			else if (k == "align")		{ o.aligns.clear(); for(const string& s : splitList(v)) o.aligns.push_back(parseBytes(s)); }
+			else if (k == "pages")		o.pages = splitList(v);
+			else if (k == "mix")		o.mixes = splitList(v);
+			else if (k == "reps")		o.reps = max(1,atoi(v.c_str()));
+			else if (k == "warmup")		o.warmup = atoi(v.c_str());
+			else if (k == "wait")		o.wait = v == "backoff" ? WaitPolicy::Backoff : v == "event" ? WaitPolicy::Event : WaitPolicy::Spin;
+			else if (k == "timeout")	o.timeout = chrono::milliseconds(atoi(v.c_str()));
+			else if (k == "json")		o.json = v;
+			else
+				throw std::invalid_argument("unknown option '" + k + "'");
+		}
+
+		if (o.afu != "memcopy" && o.afu != "blockmap")
+			throw std::invalid_argument("afu must be memcopy or blockmap");
+		if (o.afu == "memcopy")
+			o.mixes = vector<string>{ "1:1" };
+
+		for(uint64_t a : o.aligns)
+			if (a == 0 || a % 128 || (a & (a-1)))
+				throw std::invalid_argument("alignment " + to_string(a) + " is not a power of two >= 128");
+		for(const string& p : o.pages)
+			parsePages(p);
+	}
+	catch(std::invalid_argument& e)
+	{
+		cout << "ERROR: " << e.what() << endl;
+		return -1;
+	}
+
+	ofstream js(o.json.c_str());
+	if (!js)
+	{
+		cout << "ERROR: failed to open " << o.json << " for writing" << endl;
+		return -1;
+	}
+
+	const int node = cxl_numa_node(o.dev);
+
+	cout << "Device " << o.dev << " (" << o.afu << "), " << o.reps << " reps + " << o.warmup << " warmup per configuration" << endl;
+	cout << setw(10) << "size" << setw(8) << "align" << setw(6) << "pages" << setw(6) << "mix" << setw(12) << "GB/s" << setw(10) <<
+		"+/-95%" << setw(12) << "p50 us" << setw(12) << "p99 us" << setw(12) << "attach us" << endl;
+
+	js << "{\"benchmark\":\"bench_stream\",\"device\":\"" << o.dev << "\",\"afu\":\"" << o.afu << "\",\"reps\":" << o.reps <<
+		",\"warmup\":" << o.warmup << ",\"results\":[";
+	bool firstRecord=true, allOK=true;
+
+	for(const string& pages : o.pages)
+		for(uint64_t align : o.aligns)
+			for(uint64_t size : o.sizes)
+				for(const string& mix : o.mixes)
+				{
+					const pair<uint64_t,uint64_t> bytes = mixBytes(mix,size);
+					const uint64_t iSize = bytes.first, oSize = bytes.second;
+
+					// buffers aligned to exactly align: offset by align from a 2M boundary (or not at all if align >= 2M)
+					PinnedAllocPolicy policy;
+					policy.backing = parsePages(pages);
+					policy.numaNode = node;
+
+					const uint64_t offset = align < (1<<21) ? align : 0;
+					const size_t allocBytes = max(iSize,oSize)+(1<<22);
+					char* iBase = static_cast<char*>(pinned_alloc(allocBytes,policy));
+					char* oBase = static_cast<char*>(pinned_alloc(allocBytes,policy));
+					char* src = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(iBase)+(1<<21)-1) & ~uintptr_t((1<<21)-1)) + offset;
+					char* dst = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(oBase)+(1<<21)-1) & ~uintptr_t((1<<21)-1)) + offset;
+
+					for(uint64_t i=0;i<iSize/8;++i)
+						reinterpret_cast<uint64_t*>(src)[i] = i*0x9e3779b97f4a7c15ULL;
+
+					vector<double> attach, run, gbps;
+					unsigned failed=0;
+					bool dataOK=true;
+
+					for(unsigned rep=0;rep<o.warmup+o.reps;++rep)
+					{
+						memset(dst,0,oSize);
+
+						const Run r = o.afu == "memcopy" ? runMemcopy(o,src,dst,iSize) : runBlockMap(o,src,iSize,dst,oSize);
+
+						if (o.afu == "memcopy" && r.run >= 0)
+							dataOK &= memcmp(src,dst,iSize) == 0;
+
+						if (rep < o.warmup)
+							continue;
+						if (r.run < 0)
+						{
+							++failed;
+							continue;
+						}
+						attach.push_back(r.attach);
+						run.push_back(r.run);
+						gbps.push_back(double(iSize+oSize)/r.run*1e-9);
+					}
+
+					pinned_free(iBase,allocBytes,policy);
+					pinned_free(oBase,allocBytes,policy);
+
+					sort(attach.begin(),attach.end());
+					sort(run.begin(),run.end());
+
+					const size_t n = gbps.size();
+					const double mean = n ? accumulate(gbps.begin(),gbps.end(),0.0)/n : 0.0;
+					double var=0.0;
+					for(double x : gbps)
+						var += (x-mean)*(x-mean);
+					const double sd = n > 1 ? sqrt(var/(n-1)) : 0.0;
+					const double ci = t95(n)*sd/sqrt(max(n,size_t(1)));
+					const double readShare = double(iSize)/double(iSize+oSize);		// read/write rates split the same mean
+
+					allOK &= failed == 0 && dataOK;
+
+					cout << setw(10) << size << setw(8) << align << setw(6) << pages << setw(6) << mix << fixed << setprecision(3) <<
+						setw(12) << mean << setw(10) << ci << setprecision(1) << setw(12) << percentile(run,0.5)*1e6 << setw(12) <<
+						percentile(run,0.99)*1e6 << setw(12) << percentile(attach,0.5)*1e6 << (failed ? "  FAILED RUNS" : "") <<
+						(dataOK ? "" : "  DATA MISMATCH") << endl;
+
+					js << (firstRecord ? "" : ",") << endl << "{\"size\":" << size << ",\"align\":" << align << ",\"pages\":\"" << pages <<
+						"\",\"mix\":\"" << mix << "\",\"readBytes\":" << iSize << ",\"writeBytes\":" << oSize << ",\"runs\":" << n <<
+						",\"failed\":" << failed << ",\"dataOK\":" << (dataOK ? "true" : "false") << setprecision(6) <<
+						",\"throughputGBps\":{\"mean\":" << mean << ",\"stddev\":" << sd << ",\"ci95\":" << ci << ",\"min\":" <<
+						(n ? *min_element(gbps.begin(),gbps.end()) : 0.0) << ",\"max\":" << (n ? *max_element(gbps.begin(),gbps.end()) : 0.0) <<
+						"},\"readGBps\":" << mean*readShare << ",\"writeGBps\":" << mean*(1.0-readShare) <<
+						",\"latency_us\":";
+					writeStats(js,run,1e6);
+					js << ",\"attach_us\":";
+					writeStats(js,attach,1e6);
+					js << '}';
+					firstRecord = false;
+				}
+
+	js << endl << "]}" << endl;
+
+	return allOK ? 0 : 1;
+}
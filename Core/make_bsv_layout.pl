@@ -0,0 +1,294 @@
+#!/usr/bin/perl
+#
+# Generates C++ layout types (see Host/BSVLayout.hpp) mirroring the deriving(Bits) structs in BSV packages, so host code can read
+# and write fields of WEDs and stream records in place instead of hand-writing mirror structs or repacking.
+#
+# make_bsv_layout.pl <output.hpp> <package.bsv>... [-I <reference.bsv>]...
+#
+# A layout is emitted for every non-polymorphic deriving(Bits) struct in the listed packages, in namespace
+# BSVLayout::<package>. Files given with -I are only used to resolve types (eg. Core/PSLTypes.bsv for EAddress64).
+#
+# Understood types: Bit/UInt/Int/Reserved/ReservedZero#(n), Bool, enums, structs, type synonyms, numeric typedefs, LittleEndian#(t),
+# Maybe#(t) and Vector#(n,t) of scalars. Nested structs are flattened with '_' between names; a struct with a single field (eg.
+# EAddress64) is used as that field. Maybe#(t) becomes <name>_valid and <name>. Reserved fields take space but get no accessor.
+# A struct using anything else is skipped with a warning (and a comment in the output).
+#
+# Each layout has the packed size in bits and bytes, a Field/ArrayField/Bytes type per field with its exact bit offset, and
+# static asserts that every field lies within the struct.
+
+use strict;
+use warnings;
+
+$/ = undef;
+
+my $output;
+my (@primary, @reference);
+
+while (@ARGV)
+{
+    my $a = shift @ARGV;
+    if ($a eq "-I")         { push @reference, shift @ARGV; }
+    elsif (!defined $output){ $output = $a; }
+    else                    { push @primary, $a; }
+}
+
+if (!defined $output || !@primary)
+{
+    print "Usage: make_bsv_layout.pl <output.hpp> <package.bsv>... [-I <reference.bsv>]...\n";
+    exit -1;
+}
+
+my %structs;        # name -> [ [type,name], ... ]
+my %enums;          # name -> width
+my %synonyms;       # name -> type
+my %numerics;       # name -> value
+my @emit;           # [package, struct name] in file order
+
+sub parse
+{
+    my ($fn,$isPrimary) = @_;
+
+    open my $fh,"<",$fn or die "Failed to open $fn for reading";
+    my $src = <$fh>;
+    close $fh;
+
+    $src =~ s|/\*.*?\*/||gs;
+    $src =~ s|//[^\n]*||g;
+
+    my $pkg = $src =~ /\bpackage\s+(\w+)\s*;/ ? $1 : "Unknown";
+
+    while ($src =~ /\btypedef\s+struct\s*\{(.*?)\}\s*(\w+)\s*(#\s*\(.*?\))?\s*deriving\s*\(([^)]*)\)\s*;/gs)
+    {
+        my ($body,$name,$params,$derive) = ($1,$2,$3,$4);
+        next if defined $params;                        # polymorphic
+        next unless $derive =~ /\bBits\b/;
+
+        my @fields;
+        foreach my $decl (split /;/,$body)
+        {
+            $decl =~ s/^\s+|\s+$//g;
+            next if $decl eq "";
+            $decl =~ /^(.*\S)\s+(\w+)$/s or die "$fn: can't parse field \"$decl\" in struct $name";
+            my ($t,$f) = ($1,$2);
+            $t =~ s/\s+//g;
+            push @fields, [$t,$f];
+        }
+        $structs{$name} = \@fields;
+        push @emit, [$pkg,$name] if $isPrimary;
+    }
+
+    while ($src =~ /\btypedef\s+enum\s*\{(.*?)\}\s*(\w+)\s*deriving\s*\(([^)]*)\)\s*;/gs)
+    {
+        my ($body,$name) = ($1,$2);
+        my ($n,$max) = (0,0);
+        foreach my $tag (split /,/,$body)
+        {
+            next unless $tag =~ /\w/;
+            my $v = $tag =~ /=\s*(\d+)/ ? $1 : $n;
+            $max = $v if $v > $max;
+            $n = $v+1;
+        }
+        my $w = 0;
+        $w++ while (1 << $w) < $max+1;
+        $enums{$name} = $w > 0 ? $w : 1;
+    }
+
+    while ($src =~ /\btypedef\s+(\d+)\s+(\w+)\s*;/g)                  { $numerics{$2} = $1; }
+    while ($src =~ /\btypedef\s+([\w:]+(?:#\s*\([^;]*?\))?)\s+(\w+)\s*;/g)
+    {
+        my ($t,$name) = ($1,$2);
+        next if $t eq "struct" || $t eq "enum" || $t =~ /^\d+$/;
+        $t =~ s/\s+//g;
+        $synonyms{$name} = $t;
+    }
+}
+
+parse($_,0) foreach @reference;
+parse($_,1) foreach @primary;
+
+# Split "A,B" at top-level commas
+sub args
+{
+    my ($s) = @_;
+    my ($depth,$cur,@out) = (0,"");
+    foreach my $c (split //,$s)
+    {
+        if ($c eq "," && $depth == 0) { push @out,$cur; $cur = ""; next; }
+        $depth++ if $c eq "(";
+        $depth-- if $c eq ")";
+        $cur .= $c;
+    }
+    push @out,$cur;
+    return @out;
+}
+
+sub numeric
+{
+    my ($s) = @_;
+    return $s if $s =~ /^\d+$/;
+    return $numerics{$s} if exists $numerics{$s};
+    die "unknown numeric type $s\n";
+}
+
+# Splits a type into constructor and arguments: "Vector#(4,UInt#(8))" -> ("Vector", "4", "UInt#(8)")
+sub ctor
+{
+    my ($t) = @_;
+    return ($t) unless $t =~ /^(\w+)#\((.*)\)$/;
+    return ($1, args($2));
+}
+
+sub width
+{
+    my ($t) = @_;
+    my ($c,@a) = ctor($t);
+
+    return numeric($a[0])               if $c =~ /^(Bit|UInt|Int|Reserved|ReservedZero)$/;
+    return 1                            if $c eq "Bool";
+    return width($a[0])                 if $c eq "LittleEndian";
+    return 1+width($a[0])               if $c eq "Maybe";
+    return numeric($a[0])*width($a[1])  if $c eq "Vector";
+    return $enums{$c}                   if exists $enums{$c};
+    return width($synonyms{$c})         if exists $synonyms{$c} && !@a;
+
+    if (exists $structs{$c} && !@a)
+    {
+        my $w = 0;
+        $w += width($_->[0]) foreach @{$structs{$c}};
+        return $w;
+    }
+    die "unknown type $t\n";
+}
+
+# Resolve synonyms and single-field structs down to the type that is actually stored
+sub underlying
+{
+    my ($t) = @_;
+    for (;;)
+    {
+        my ($c,@a) = ctor($t);
+        if (!@a && exists $synonyms{$c})                                    { $t = $synonyms{$c}; }
+        elsif (!@a && exists $structs{$c} && @{$structs{$c}} == 1)          { $t = $structs{$c}->[0]->[0]; }
+        else                                                                { return $t; }
+    }
+}
+
+sub scalar
+{
+    my ($t) = @_;
+    my ($c) = ctor(underlying($t));
+    return $c =~ /^(Bit|UInt|Int|Bool)$/ || exists $enums{$c};
+}
+
+# Appends [name, C++ type, declared type] for the fields of type t at bit position pos
+sub flatten
+{
+    my ($t,$name,$pos,$le,$out,$decl) = @_;
+    $decl = $t unless defined $decl;
+    my $u = underlying($t);
+    my ($c,@a) = ctor($u);
+    my $w = width($u);
+
+    if ($c eq "Reserved" || $c eq "ReservedZero")
+    {
+        return;
+    }
+    elsif ($c eq "LittleEndian")
+    {
+        my $p = underlying($a[0]);
+        die "LittleEndian# of non-scalar $a[0] in $name\n" unless scalar($p);
+        flatten($p,$name,$pos,1,$out,$decl);
+    }
+    elsif ($c eq "Maybe")
+    {
+        push @$out, [$name."_valid","Field<$pos,1>","valid bit of $decl"];
+        flatten($a[0],$name,$pos+1,$le,$out,$decl);
+    }
+    elsif ($c eq "Vector")
+    {
+        my $n = numeric($a[0]);
+        my $e = underlying($a[1]);
+        my ($ec,@ea) = ctor($e);
+        my $ele = 0;
+        if ($ec eq "LittleEndian") { $ele = 1; $e = underlying($ea[0]); }
+        die "Vector of non-scalar $a[1] in $name\n" unless scalar($e);
+        my $ew = width($e);
+        die "Vector element wider than 64b in $name\n" if $ew > 64;
+        push @$out, [$name,"ArrayField<$pos,$ew,$n".($ele ? ",true" : "").">",$decl];
+    }
+    elsif (exists $structs{$c})
+    {
+        my $p = $pos;
+        foreach my $f (@{$structs{$c}})
+        {
+            flatten($f->[0],($name eq "" ? "" : $name."_").$f->[1],$p,$le,$out);
+            $p += width($f->[0]);
+        }
+    }
+    elsif ($w > 64)
+    {
+        die "field $name wider than 64b is not byte-aligned\n" if $pos % 8 || $w % 8;
+        push @$out, [$name,"Bytes<$pos,$w>",$decl];
+    }
+    else
+    {
+        push @$out, [$name,"Field<$pos,$w".($le ? ",true" : "").">",$decl];
+    }
+}
+
+open my $ofh,">",$output or die "Failed to open $output for writing";
+
+my $guard = uc($output);
+$guard =~ s|.*/||;
+$guard =~ s/\W/_/g;
+
+print $ofh "// DO NOT EDIT! Automatically generated file\n";
+print $ofh "// Created by make_bsv_layout.pl from ".join(" ",@primary)."\n\n";
+print $ofh "#ifndef ${guard}_\n#define ${guard}_\n\n";
+print $ofh "#include <BlueLink/Host/BSVLayout.hpp>\n";
+
+my $openPkg = "";
+
+foreach my $e (@emit)
+{
+    my ($pkg,$name) = @$e;
+
+    if ($pkg ne $openPkg)
+    {
+        print $ofh "\n}\n}\n" if $openPkg ne "";
+        print $ofh "\nnamespace BSVLayout {\nnamespace $pkg {\n";
+        $openPkg = $pkg;
+    }
+
+    my (@fields,$w);
+    eval {
+        $w = width($name);
+        my $p = 0;
+        foreach my $f (@{$structs{$name}})
+        {
+            flatten($f->[0],$f->[1],$p,0,\@fields);
+            $p += width($f->[0]);
+        }
+    };
+    if ($@)
+    {
+        (my $err = $@) =~ s/\s+$//;
+        print STDERR "WARNING: make_bsv_layout.pl skipping struct $name ($err)\n";
+        print $ofh "\n// $name skipped: $err\n";
+        next;
+    }
+
+    my $bytes = int(($w+7)/8);
+
+    print $ofh "\n/// $name: $w bits\nstruct $name\n{\n";
+    print $ofh "\tstatic constexpr std::size_t bits = $w;\n";
+    print $ofh "\tstatic constexpr std::size_t bytes = $bytes;\n\n";
+    printf $ofh "\ttypedef %-32s %-24s // %s\n",$_->[1],$_->[0].";",$_->[2] foreach @fields;
+    print $ofh "};\n\n";
+
+    print $ofh "static_assert($name\::$_->[0]\::end <= $name\::bits,\"$name\::$_->[0] outside the struct\");\n" foreach @fields;
+}
+
+print $ofh "\n}\n}\n" if $openPkg ne "";
+print $ofh "\n#endif\n";
+close $ofh;
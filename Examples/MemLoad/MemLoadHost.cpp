@@ -7,6 +7,7 @@
 
 #include <BlueLink/Host/AFU.hpp>
 #include <BlueLink/Host/WED.hpp>
+#include <BlueLink/Host/Profiler.hpp>
 
 #include <boost/range/algorithm.hpp>
 
@@ -57,6 +58,9 @@ int main(int argc,char **argv)
 
 	BOOST_STATIC_ASSERT(logNL >= 6);
 
+	Profiler prof;
+	prof.threadName("main");
+
 	StackWED<MemLoadWED,128,128> wed;
 
 	vector<uint64_t,aligned_allocator<uint64_t,128>> src(Nui64,0),dst(Nui64,0);
@@ -69,8 +73,11 @@ int main(int argc,char **argv)
 	wed->size = NB;
 
 	// fill source with random numbers
-	boost::mt19937_64 rng;
-	boost::generate(src, rng);
+	{
+		Profiler::Span s(&prof,"generate input");
+		boost::mt19937_64 rng;
+		boost::generate(src, rng);
+	}
 
 	ofstream os("output.expected.hex");
 
@@ -81,7 +88,11 @@ int main(int argc,char **argv)
 
 	// start accelerator
 	AFU afu("/dev/cxl0.0d");
-	afu.start(wed);
+	{
+		Profiler::Span s(&prof,"attach");
+		afu.start(wed);
+	}
+	prof.clock().sample(afu,0x08);
 	sleep(1);
 
 
@@ -94,8 +105,11 @@ int main(int argc,char **argv)
 
 	unsigned i;
 
-	for(i=0;i<timeout && (tsH2ADone = afu.mmio_read64(0x18)) == 0; ++i)
-		sleep(1);
+	{
+		Profiler::Span s(&prof,"await host->AFU");
+		for(i=0;i<timeout && (tsH2ADone = afu.mmio_read64(0x18)) == 0; ++i)
+			sleep(1);
+	}
 
 	if (i==timeout)
 		cout << "TIMEOUT!" << endl;
@@ -124,6 +138,7 @@ int main(int argc,char **argv)
 	cout << "Checking BRAM readback: " << endl;
 	for(const auto p : addrs)
 	{
+		Profiler::Span s(&prof,"BRAM readback");
 
 		afu.mmio_write64(0x00,(p.first << 16) | p.second);
 		cout << " Bank " << hex << (unsigned)p.first << " offset " << hex << p.second << ' ';
@@ -152,11 +167,14 @@ int main(int argc,char **argv)
 	uint64_t tsA2HStart=afu.mmio_read64(0x20);
 	uint64_t tsA2HDone =afu.mmio_read64(0x28);
 
-	for(unsigned i=0;i<timeout && (tsA2HDone = afu.mmio_read64(0x28)) == 0; ++i)
 	{
+		Profiler::Span s(&prof,"await AFU->host");
+		for(unsigned i=0;i<timeout && (tsA2HDone = afu.mmio_read64(0x28)) == 0; ++i)
+		{
 #ifdef SIM
-		sleep(1);
+			sleep(1);
 #endif
+		}
 	}
 
 	if (i==timeout)
@@ -164,6 +182,13 @@ int main(int argc,char **argv)
 
 	cout << "AFU->host transfer started at " << tsA2HStart << " and finished at " << tsA2HDone << " (duration " << tsA2HDone-tsA2HStart << ")" << endl;
 
+	// second clock sample fits the AFU clock rate over the whole job
+	prof.clock().sample(afu,0x08);
+	prof.afuSpan("transfers","host->AFU",tsH2AStart,tsH2ADone);
+	prof.afuSpan("transfers","AFU->host",tsA2HStart,tsA2HDone);
+
+	cout << "AFU clock " << dec << prof.clock().hz()*1e-6 << " MHz (+/- " << prof.clock().uncertainty_ns() << " ns)" << endl;
+
 
 
 	////// Check output
@@ -176,13 +201,18 @@ int main(int argc,char **argv)
 		os << setw(16) << hex << o << endl;
 	os.close();
 
-	for(unsigned i=0;i<Nui64;++i)
-		if (src[i] != dst[i])
-			cout << "Mismatch at byte offset " << std::hex << setw(8) << 8*i << ": expected " << setw(16) << std::hex << src[i] << " and received " << setw(16) << std::hex << dst[i] << endl;
+	{
+		Profiler::Span s(&prof,"check output");
+		for(unsigned i=0;i<Nui64;++i)
+			if (src[i] != dst[i])
+				cout << "Mismatch at byte offset " << std::hex << setw(8) << 8*i << ": expected " << setw(16) << std::hex << src[i] << " and received " << setw(16) << std::hex << dst[i] << endl;
+	}
 
 	cout << "Output check done" << endl;
 
 	afu.mmio_write64(0x10,0);
 
+	prof.writeChromeTrace("MemLoad.trace.json");
+
 	return 0;
 }
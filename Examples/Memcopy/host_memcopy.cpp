@@ -16,7 +16,9 @@
 
 #include <BlueLink/Host/AFU.hpp>
 #include <BlueLink/Host/WED.hpp>
+#include <BlueLink/Host/WaitPolicy.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <functional>
@@ -85,31 +87,26 @@ int main (int argc, char *argv[])
 
 	afu.start(wed.get());
 
-	unsigned long long st=0;
+	// poll with exponential backoff: fast response on hardware without hammering a slow simulation
+	WaitPolicy wait(WaitPolicy::Backoff);
+	if (sim)
+		wait.backoff(chrono::milliseconds(1),chrono::milliseconds(100));
 
-	unsigned N;
-	for(N=0;N<100 && (st=afu.mmio_read64(0)) != STATUS_WAITING;++N)
-	{
-		cout << "  Waiting for 'waiting' status (st=" << st << " looking for " << STATUS_WAITING << ")" << endl;
-		usleep(sim ? 100000 : 100);
-	}
+	if (!wait.until([&afu]{ return afu.mmio_read64(0) == STATUS_WAITING; },chrono::seconds(sim ? 10 : 1)))
+		cout << "  Timeout waiting for 'waiting' status (st=" << afu.mmio_read64(0) << " looking for " << STATUS_WAITING << ")" << endl;
 
 	for(unsigned i=0;i<4;++i)
 		cout << "MMIO[" << setw(6) << hex << (i<<3) << "] " << setw(16) << hex << afu.mmio_read64(i<<3) << endl;
 
+	wait.resetStats();					// so the latency reported below is for the copy only
+
 	cout << "Starting" << endl;
 	afu.mmio_write64(0,0x0ULL);		// start signal: write 0 to MMIO 0
 
-	unsigned timeout=1000;
-
-	for(N=0;N < timeout && (st=afu.mmio_read64(0)) != STATUS_DONE;++N)	// wait for done status
-	{
-		cout << "  status " << st << endl << flush;
-		usleep(sim ? 100000 : 1000);
-	}
-
-	if (N == timeout)
+	if (!wait.until([&afu]{ return afu.mmio_read64_fast(0) == STATUS_DONE; },chrono::seconds(sim ? 100 : 1)))	// wait for done status
 		cout << "ERROR: Timeout waiting for done status" << endl;
+	else
+		cout << "Done after " << wait.latency().mean_ns()*1e-3 << " us" << endl;
 
 	cout << "Terminating" << endl;
 	afu.mmio_write64(0,0x1ULL);
@@ -6,10 +6,17 @@
  */
 
 #include "AFU.hpp"
+#include "AFUBackend.hpp"
+#include "Trace.hpp"
 #include "WED.hpp"
 #include <iostream>
 #include <iomanip>
 
+#include <chrono>
+
+#include <poll.h>
+#include <sys/mman.h>
+
 extern "C" {
 	#include <libcxl.h>
 }
@@ -38,12 +45,25 @@ AFU::AFU(const std::string devstr) : m_devstr(devstr)
 	open();
 }
 
+AFU::AFU(std::unique_ptr<AFUBackend> backend) :
+	m_devstr(AFUBackend::prefix),
+	m_backend(std::move(backend))
+{
+}
+
 AFU::AFU(AFU&& afu)
 {
 	swap(afu.m_devstr,m_devstr);
 
 	m_afu_h = afu.m_afu_h;
 	afu.m_afu_h = nullptr;
+
+	m_mmio = afu.m_mmio;
+	m_mmioSize = afu.m_mmioSize;
+	afu.m_mmio = nullptr;
+	afu.m_mmioSize = 0;
+
+	m_backend = std::move(afu.m_backend);
 }
 
 AFU::~AFU()
@@ -53,6 +73,9 @@ AFU::~AFU()
 
 void AFU::open()
 {
+	if ((m_backend = AFUBackend::create(m_devstr)))
+		return;
+
 	m_afu_h = cxl_afu_open_dev((char*)m_devstr.c_str());
 	if (!m_afu_h)
 		throw InvalidDevice(m_devstr);
@@ -71,25 +94,39 @@ void AFU::close()
 		mmio_unmap();
 		cxl_afu_free(m_afu_h);
 	}
+	m_backend.reset();
 	m_devstr.clear();
 	m_afu_h=nullptr;
 }
 
+void AFU::reopen()
+{
+	const std::string devstr = m_devstr;
+	close();
+	open(devstr);
+}
+
 void AFU::start(void* p)
 {
+	if (m_backend)
+	{
+		m_backend->attach(p);
+		BLUELINK_TRACE(AttachEmulated,p);
+		return;
+	}
+
 	if(!m_afu_h)
 		throw InvalidDevice(m_devstr);
 
 	int ret = cxl_afu_attach(m_afu_h,(__u64)p);
 	if (ret)
 	{
-		std::cerr << "cxl_afu_attach failed with error code: " << ret << std::endl;
-		std::cerr << "  strerror(errno): " << strerror(errno) << std::endl;
+		BLUELINK_TRACE(AttachFailed,ret,errno);
 		throw InvalidDevice(m_devstr);
 	}
-	cout << "AFU started with WED " << p << endl;
+	BLUELINK_TRACE(Attach,p);
 	mmio_map();
-	cout << "  and MMIO mapped" << endl;
+	BLUELINK_TRACE(MMIOMapped,m_mmioSize);
 }
 
 void AFU::start(const WED& w)
@@ -103,23 +140,35 @@ void AFU::mmio_map()
 	int ret;
 	if ((ret=cxl_mmio_map(m_afu_h,CXL_MMIO_BIG_ENDIAN)))
 	{
-		cerr << "cxl_mmio_map failed with error code: " << ret << endl;
-		cerr << "  strerror(errno): " << strerror(errno) << endl;
+		BLUELINK_TRACE(MMIOMapFailed,ret,errno);
 		throw MMIOMapFail();
 	}
+
+	// Try to map the problem-state area directly for the inline fast path. This only works with a real cxl device file; if it
+	// fails (eg. PSLSE simulation) the fast-path calls fall back to libcxl.
+	long sz=0;
+	if (cxl_get_mmio_size(m_afu_h,&sz) == 0 && sz > 0)
+	{
+		void* p = mmap(nullptr,sz,PROT_READ|PROT_WRITE,MAP_SHARED,cxl_afu_fd(m_afu_h),0);
+		if (p != MAP_FAILED)
+		{
+			m_mmio = static_cast<volatile uint64_t*>(p);
+			m_mmioSize = sz;
+		}
+	}
 }
 
 uint64_t AFU::mmio_read64(const unsigned offset) const
 {
 	uint64_t t;
 	int ret;
-	if (!m_afu_h)
+	if (m_backend)
+		t = m_backend->mmio_read64(offset);
+	else if (!m_afu_h)
 		throw InvalidDevice(m_devstr);
-	if ((ret=cxl_mmio_read64(m_afu_h,offset,&t)))
-	{
-		cout << "cxl_mmio_read64 returned a nonzero exit code: " << ret << endl;
-		cout << "  error string: " << strerror(errno) << endl;
-	}
+	else if ((ret=cxl_mmio_read64(m_afu_h,offset,&t)))
+		BLUELINK_TRACE(MMIOReadFailed,64,offset,ret,errno);
+	BLUELINK_TRACE(MMIORead,offset,t);
 	return t;
 }
 
@@ -128,86 +177,153 @@ uint32_t AFU::mmio_read32(const unsigned offset) const
 {
 	uint32_t t;
 	int ret;
-	if (!m_afu_h)
+	if (m_backend)
+		t = m_backend->mmio_read32(offset);
+	else if (!m_afu_h)
 		throw InvalidDevice(m_devstr);
-	if ((ret=cxl_mmio_read32(m_afu_h,offset,&t)))
-	{
-		cout << "cxl_mmio_read32 returned a nonzero exit code: " << ret << endl;
-		cout << "  error string: " << strerror(errno) << endl;
-	}
+	else if ((ret=cxl_mmio_read32(m_afu_h,offset,&t)))
+		BLUELINK_TRACE(MMIOReadFailed,32,offset,ret,errno);
+	BLUELINK_TRACE(MMIORead,offset,t);
 	return t;
 }
 
 void AFU::mmio_write64(const unsigned offset,const uint64_t data) const
 {
 	int ret;
-	if (!m_afu_h)
+	if (m_backend)
+		m_backend->mmio_write64(offset,data);
+	else if (!m_afu_h)
 		throw InvalidDevice(m_devstr);
-	if ((ret=cxl_mmio_write64(m_afu_h,offset,data)))
-	{
-		cout << "cxl_mmio_write64 returned a nonzero exit code: " << ret << endl;
-		cout << "  error string: " << strerror(errno) << endl;
-	}
+	else if ((ret=cxl_mmio_write64(m_afu_h,offset,data)))
+		BLUELINK_TRACE(MMIOWriteFailed,64,offset,ret,errno);
+	BLUELINK_TRACE(MMIOWrite,offset,data);
 }
 
 void AFU::mmio_write32(const unsigned offset,const uint32_t data) const
 {
 	int ret;
-	if (!m_afu_h)
+	if (m_backend)
+		m_backend->mmio_write32(offset,data);
+	else if (!m_afu_h)
 		throw InvalidDevice(m_devstr);
-	if ((ret=cxl_mmio_write32(m_afu_h,offset,data)))
-	{
-		cout << "cxl_mmio_write32 returned a nonzero exit code: " << ret << endl;
-		cout << "  error string: " << strerror(errno) << endl;
-	}
+	else if ((ret=cxl_mmio_write32(m_afu_h,offset,data)))
+		BLUELINK_TRACE(MMIOWriteFailed,32,offset,ret,errno);
+	BLUELINK_TRACE(MMIOWrite,offset,data);
 }
 
 void AFU::mmio_unmap()
 {
+	if (m_mmio)
+		munmap(const_cast<uint64_t*>(m_mmio),m_mmioSize);
+	m_mmio=nullptr;
+	m_mmioSize=0;
+
 	if (cxl_mmio_unmap(m_afu_h))
 		throw MMIOUnmapFail();
 }
 
-void AFU::await_event(unsigned timeout_ms) const
+AFU::Event AFU::await_event(unsigned timeout_ms) const
 {
-	unsigned i;
-	for(i=0;i<timeout_ms /* && !cxl_event_pending(afu_h_) */; ++i)
-	{
-		usleep(1000);			// pause 10ms
-	}
+	Event ev;
+
+	if (m_backend)
+		return m_backend->await_event(timeout_ms);
+
+	if (!m_afu_h)
+		throw InvalidDevice(m_devstr);
 
-	if (i==timeout_ms)
+	if (!cxl_event_pending(m_afu_h))
 	{
-		cout << "  No event received, timed out after " << timeout_ms << " ms" << endl;
-		return;
+		struct pollfd pfd;
+		pfd.fd = cxl_afu_fd(m_afu_h);
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		int ret;
+		while((ret=poll(&pfd,1,timeout_ms)) < 0 && errno == EINTR){}
+
+		if (ret < 0)
+		{
+			BLUELINK_TRACE(EventPollFailed,errno);
+			return ev;
+		}
+		else if (ret == 0)
+			return ev;
 	}
 
 	struct cxl_event e;
 	int ret = cxl_read_event(m_afu_h,&e);
 
-	if (ret == 0)
+	if (ret != 0)
+	{
+		BLUELINK_TRACE(EventReadFailed,ret);
+		return ev;
+	}
+
+	switch(e.header.type)
+	{
+	case CXL_EVENT_AFU_INTERRUPT:
+		ev.type = Event::Interrupt;
+		ev.irq = e.irq.irq;
+		break;
+	case CXL_EVENT_DATA_STORAGE:
+		ev.type = Event::DataStorage;
+		ev.data = e.fault.addr;
+		break;
+	case CXL_EVENT_AFU_ERROR:
+		ev.type = Event::Error;
+		ev.data = e.afu_error.error;
+		break;
+	default:
+		ev.type = Event::Reserved;
+	}
+	return ev;
+}
+
+bool AFU::await_interrupt(const unsigned irq,const unsigned timeout_ms) const
+{
+	return await_interrupts(1u << irq,timeout_ms) == irq;
+}
+
+unsigned AFU::await_interrupts(const unsigned mask,const unsigned timeout_ms) const
+{
+	const auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+
+	for(auto now=chrono::steady_clock::now(); now < deadline; now=chrono::steady_clock::now())
 	{
-		cout << "Received event: ";
-		switch(e.header.type)
+		Event ev = await_event(chrono::duration_cast<chrono::milliseconds>(deadline-now).count()+1);
+
+		switch(ev.type)
 		{
-		case CXL_EVENT_RESERVED:
-			cout << "(reserved)"; break;
-		case CXL_EVENT_AFU_INTERRUPT:
-			cout << "AFU Interrupt code " << e.irq.irq << " with flags " << hex << setw(4) << e.irq.flags; break;
-		case CXL_EVENT_DATA_STORAGE:
-			cout << "Data storage"; break;
-		case CXL_EVENT_AFU_ERROR:
-			cout << "AFU error code " << e.afu_error.error << " with flags " << e.afu_error.flags; break;
+		case Event::None:
+			return 0;
+		case Event::Interrupt:
+			BLUELINK_TRACE(Interrupt,ev.irq);
+			if (ev.irq < 32 && (mask >> ev.irq & 1))
+				return ev.irq;
+			break;
+		case Event::DataStorage:
+			BLUELINK_TRACE(DataStorageFault,ev.data);
+			return 0;
+		case Event::Error:
+			BLUELINK_TRACE(AFUError,ev.data);
+			return 0;
+		default:
+			break;
 		}
-		cout << endl;
 	}
-	else
-		cout << "Unexpected return from cxl_read_event: " << ret << endl;
+	return 0;
 }
 
 void AFU::print_details() const
 {
 	cout << "AFU details: " << endl;
+
+	if (m_backend)
+	{
+		cout << "  " << m_backend->description() << endl;
+		return;
+	}
 #ifdef HARDWARE
 
 	int ret;
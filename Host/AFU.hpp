@@ -14,12 +14,20 @@
 #include <string>
 
 #include <map>
+#include <memory>
 
 
 #include <string.h>			// for strerror
 #include <sys/errno.h>
 
+#include <cinttypes>
+#include <cstddef>
+#include <endian.h>				// for be64toh/htobe64
+
+#include <BlueLink/Host/Trace.hpp>
+
 class WED;
+class AFUBackend;
 
 class AFU {
 
@@ -35,10 +43,12 @@ public:
 
 	AFU();
 	AFU(const char* devstr);
-	AFU(std::string devstr);
+	AFU(std::string devstr);				// "emu:<name>[:<args>]" opens a software backend instead of a device (see AFUBackend.hpp)
+	AFU(std::unique_ptr<AFUBackend> backend);
 
 	void open(std::string);
 	void close();
+	void reopen();							///< Close and open the same device again (detaching resets the AFU)
 
 	void start(void*);
 	void start(const WED&);
@@ -51,7 +61,43 @@ public:
 	void mmio_write64(unsigned,uint64_t) const;
 	void mmio_write32(unsigned,uint32_t) const;
 
-	void await_event(unsigned) const;
+	/** Fast-path MMIO through a direct mapping of the problem-state area, bypassing libcxl and its error checks/printing.
+	 * Swap=true gives the same (host-order) result as mmio_read64/mmio_write64; Swap=false skips the endian swap and moves the
+	 * raw big-endian register value.
+	 *
+	 * If the direct mapping is not available (eg. PSLSE simulation), these fall back to the libcxl calls.
+	 */
+	template<bool Swap=true>uint64_t 	mmio_read64_fast(unsigned offset) const;
+	template<bool Swap=true>void 		mmio_write64_fast(unsigned offset,uint64_t data) const;
+
+	/// Reads N contiguous 64b registers starting at byte offset into o[0..N-1] (host order)
+	void mmio_read_block(unsigned offset,std::size_t N,uint64_t* o) const;
+
+	/// True if the fast path has a direct mapping (false -> falls back to libcxl)
+	bool mmio_fast_available() const { return m_mmio != nullptr; }
+
+	/// True if running on a software backend rather than libcxl
+	bool emulated() const { return m_backend != nullptr; }
+
+	/// Event received from the AFU (decoded from libcxl's struct cxl_event)
+	struct Event
+	{
+		enum Type { None, Interrupt, DataStorage, Error, Reserved };
+
+		Type		type=None;			// None -> timed out
+		unsigned	irq=0;				// interrupt source number (Interrupt)
+		uint64_t	data=0;				// faulting address (DataStorage) or error code (Error)
+	};
+
+	/// Block on the cxl event file descriptor (no CPU used while waiting) until an event arrives or timeout_ms elapses
+	Event await_event(unsigned timeout_ms) const;
+
+	/// Wait for the given AFU interrupt; returns false on timeout or if a fault/error event arrives first
+	bool await_interrupt(unsigned irq,unsigned timeout_ms) const;
+
+	/// Wait for any of the AFU interrupts in mask (bit i set for source i); returns the source received, or 0 on timeout or if a
+	/// fault/error event arrives first
+	unsigned await_interrupts(unsigned mask,unsigned timeout_ms) const;
 
 	~AFU();
 
@@ -61,6 +107,11 @@ private:
 	std::string 		m_devstr="";
 	struct cxl_afu_h* 	m_afu_h=nullptr;
 
+	volatile uint64_t*	m_mmio=nullptr;			// direct mapping of problem-state area (nullptr if unavailable)
+	std::size_t			m_mmioSize=0;
+
+	std::unique_ptr<AFUBackend>	m_backend;		// software backend replacing libcxl (nullptr for a real/simulated device)
+
 	void open();
 	void mmio_map();
 	void mmio_unmap();
@@ -100,5 +151,41 @@ public:
 };
 
 
+template<bool Swap>inline uint64_t AFU::mmio_read64_fast(const unsigned offset) const
+{
+	if (!m_mmio)
+	{
+		uint64_t t = mmio_read64(offset);
+		return Swap ? t : htobe64(t);
+	}
+	uint64_t t = m_mmio[offset>>3];
+	BLUELINK_TRACE(MMIORead,offset,be64toh(t));
+	return Swap ? be64toh(t) : t;
+}
+
+template<bool Swap>inline void AFU::mmio_write64_fast(const unsigned offset,const uint64_t data) const
+{
+	if (!m_mmio)
+		mmio_write64(offset,Swap ? data : be64toh(data));
+	else
+	{
+		__sync_synchronize();			// make sure prior host memory writes (eg. WED, buffers) are visible before the AFU sees this
+		m_mmio[offset>>3] = Swap ? htobe64(data) : data;
+		BLUELINK_TRACE(MMIOWrite,offset,Swap ? data : be64toh(data));
+	}
+}
+
+inline void AFU::mmio_read_block(const unsigned offset,const std::size_t N,uint64_t* o) const
+{
+	if (m_mmio)
+	{
+		const volatile uint64_t* p = m_mmio + (offset>>3);
+		for(std::size_t i=0;i<N;++i)
+			o[i] = be64toh(p[i]);
+	}
+	else
+		for(std::size_t i=0;i<N;++i)
+			o[i] = mmio_read64(offset+(i<<3));
+}
 
 #endif /* AFU_HPP_ */
@@ -0,0 +1,68 @@
+/*
+ * AFUBackend.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "AFUBackend.hpp"
+#include "BlockMapEmulator.hpp"
+
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+mutex registryMutex;
+
+map<string,AFUBackend::Factory>& registry()
+{
+	static map<string,AFUBackend::Factory> r{
+		make_pair("blockmap",[](const string& args){ return unique_ptr<AFUBackend>(new BlockMapEmulator(args)); }),
+		make_pair("memcopy",[](const string& args){ return unique_ptr<AFUBackend>(new MemcopyEmulator(args)); })
+	};
+	return r;
+}
+
+}
+
+uint32_t AFUBackend::mmio_read32(const unsigned offset)
+{
+	return mmio_read64(offset & ~7U) >> (offset & 4 ? 32 : 0);
+}
+
+void AFUBackend::mmio_write32(const unsigned offset,const uint32_t data)
+{
+	uint64_t t = mmio_read64(offset & ~7U);
+	const unsigned sh = offset & 4 ? 32 : 0;
+	mmio_write64(offset & ~7U,(t & ~(0xffffffffULL << sh)) | (uint64_t(data) << sh));
+}
+
+unique_ptr<AFUBackend> AFUBackend::create(const string& devstr)
+{
+	const string pfx(prefix);
+
+	if (devstr.compare(0,pfx.size(),pfx) != 0)
+		return nullptr;
+
+	const size_t colon = devstr.find(':',pfx.size());
+	const string name = devstr.substr(pfx.size(),colon == string::npos ? string::npos : colon-pfx.size());
+	const string args = colon == string::npos ? "" : devstr.substr(colon+1);
+
+	Factory f;
+	{
+		lock_guard<mutex> L(registryMutex);
+		auto it = registry().find(name);
+		if (it == registry().end())
+			throw AFU::InvalidDevice(devstr);
+		f = it->second;
+	}
+	return f(args);
+}
+
+void AFUBackend::registerBackend(const string& name,Factory f)
+{
+	lock_guard<mutex> L(registryMutex);
+	registry()[name] = f;
+}
@@ -0,0 +1,53 @@
+/*
+ * AFUBackend.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef AFUBACKEND_HPP_
+#define AFUBACKEND_HPP_
+
+#include "AFU.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/** Software stand-in for the libcxl device behind an AFU.
+ *
+ * An AFU opened with a device string of the form "emu:<name>[:<args>]" creates the backend registered under <name> (passing
+ * it <args>) and routes attach, MMIO and events to it instead of libcxl. Host code runs unchanged, at full speed, without
+ * hardware or PSLSE. The direct-mapped MMIO fast path is never available so the _fast calls go through the backend too.
+ *
+ * Built in: "blockmap" (BlockMapEmulator) and "memcopy" (MemcopyEmulator), see BlockMapEmulator.hpp
+ */
+
+class AFUBackend
+{
+public:
+	typedef std::function<std::unique_ptr<AFUBackend>(const std::string& args)> Factory;
+
+	virtual ~AFUBackend(){}
+
+	virtual void attach(void* wed)=0;
+
+	virtual uint64_t mmio_read64(unsigned offset)=0;
+	virtual void mmio_write64(unsigned offset,uint64_t data)=0;
+
+	// 32b accesses default to the corresponding half of the 64b register (low word at the lower address)
+	virtual uint32_t mmio_read32(unsigned offset);
+	virtual void mmio_write32(unsigned offset,uint32_t data);
+
+	virtual AFU::Event await_event(unsigned timeout_ms)=0;
+
+	virtual std::string description() const=0;
+
+	static constexpr const char* prefix="emu:";
+
+	/// Creates a backend for devstr if it names an emulator, else returns nullptr; throws AFU::InvalidDevice for unknown names
+	static std::unique_ptr<AFUBackend> create(const std::string& devstr);
+
+	static void registerBackend(const std::string& name,Factory f);
+};
+
+#endif /* AFUBACKEND_HPP_ */
@@ -0,0 +1,92 @@
+/*
+ * AFUContextPool.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "AFUContextPool.hpp"
+#include "WaitPolicy.hpp"
+#include "WED.hpp"
+
+using namespace std;
+
+AFUContextPool::AFUContextPool(const std::string devstr,const unsigned N)
+{
+	m_contexts.reserve(N);
+	m_free.reserve(N);
+
+	for(unsigned i=0;i<N;++i)
+	{
+		m_contexts.emplace_back(new AFU(devstr));
+		m_contexts.back()->start(nullptr);			// attach without a WED; jobs arrive through the doorbell
+		m_free.push_back(m_contexts.back().get());
+	}
+}
+
+AFUContextPool::~AFUContextPool()
+{
+	std::unique_lock<std::mutex> L(m_mutex);
+	if (m_free.size() != m_contexts.size())
+		BLUELINK_TRACE(ContextsLeased,m_contexts.size()-m_free.size());
+}
+
+AFUContextPool::Lease AFUContextPool::acquire()
+{
+	std::unique_lock<std::mutex> L(m_mutex);
+	m_cv.wait(L,[this]{ return !m_free.empty(); });
+
+	AFU* afu = m_free.back();
+	m_free.pop_back();
+	return Lease(this,afu);
+}
+
+bool AFUContextPool::try_acquire(Lease& l)
+{
+	std::unique_lock<std::mutex> L(m_mutex);
+	if (m_free.empty())
+		return false;
+
+	AFU* afu = m_free.back();
+	m_free.pop_back();
+	L.unlock();
+
+	l = Lease(this,afu);
+	return true;
+}
+
+unsigned AFUContextPool::available() const
+{
+	std::unique_lock<std::mutex> L(m_mutex);
+	return m_free.size();
+}
+
+void AFUContextPool::release(AFU* afu)
+{
+	{
+		std::unique_lock<std::mutex> L(m_mutex);
+		m_free.push_back(afu);
+	}
+	m_cv.notify_one();
+}
+
+void AFUContextPool::Lease::submit(const WED& w) const
+{
+	submit(w.get());
+}
+
+void AFUContextPool::Lease::submit(const void* p) const
+{
+	m_afu->mmio_write64_fast(DoorbellOffset,reinterpret_cast<uint64_t>(p));
+}
+
+unsigned AFUContextPool::Lease::outstanding() const
+{
+	const uint64_t counts = m_afu->mmio_read64_fast(DoorbellOffset);
+	return uint32_t(counts >> 32) - uint32_t(counts);		// counters wrap together
+}
+
+bool AFUContextPool::Lease::wait(const std::chrono::milliseconds timeout) const
+{
+	WaitPolicy w(WaitPolicy::Backoff);
+	return w.until([this]{ return outstanding() == 0; },timeout);
+}
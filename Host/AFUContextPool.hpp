@@ -0,0 +1,110 @@
+/*
+ * AFUContextPool.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef AFUCONTEXTPOOL_HPP_
+#define AFUCONTEXTPOOL_HPP_
+
+#include <BlueLink/Host/AFU.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WED;
+
+/** Pool of attached AFU-directed contexts (see DedicatedAFU/DirectedAFU.bsv) shared among threads.
+ *
+ * Each context is opened on the shared-mode device (eg. /dev/cxl/afu0.0s) and attached once when the pool is created, so a job
+ * only costs a doorbell write instead of an attach/detach. acquire() blocks until a context is free and returns a Lease which
+ * gives it back to the pool when destroyed.
+ *
+ * Jobs are submitted by writing the WED address to the context's per-process doorbell (problem-state offset 0). Reading the same
+ * offset gives the context's job counts (submitted in the upper word, finished in the lower), so Lease::wait() can tell when
+ * every submitted job has finished. The lease should be waited on before it's released, since the next holder's jobs would
+ * otherwise be counted together with any still running.
+ */
+
+class AFUContextPool
+{
+public:
+	class Lease;
+
+	AFUContextPool(std::string devstr,unsigned N);
+	~AFUContextPool();
+
+	AFUContextPool(const AFUContextPool&) = delete;
+	AFUContextPool& operator=(const AFUContextPool&) = delete;
+
+	Lease acquire();						// blocks until a context is available
+	bool try_acquire(Lease& l);				// non-blocking; returns false if none available
+
+	unsigned size() const { return m_contexts.size(); }
+	unsigned available() const;
+
+	static constexpr unsigned DoorbellOffset=0x0;		// write: WED address; read: job counts
+
+private:
+	void release(AFU* afu);
+
+	std::vector<std::unique_ptr<AFU>>	m_contexts;
+	std::vector<AFU*>					m_free;
+
+	mutable std::mutex					m_mutex;
+	std::condition_variable				m_cv;
+};
+
+
+/** Exclusive use of one pooled context, returned to the pool on destruction (move but no copy) */
+
+class AFUContextPool::Lease
+{
+public:
+	Lease(){}
+	Lease(Lease&& l) : m_pool(l.m_pool),m_afu(l.m_afu){ l.m_afu=nullptr; }
+	Lease(const Lease&) = delete;
+
+	Lease& operator=(Lease&& l)
+	{
+		reset();
+		m_pool=l.m_pool;
+		m_afu=l.m_afu;
+		l.m_afu=nullptr;
+		return *this;
+	}
+
+	~Lease(){ reset(); }
+
+	/// Submits a job to this context by writing the WED address to its doorbell
+	void submit(const WED& w) const;
+	void submit(const void* p) const;
+
+	/// Number of submitted jobs that haven't finished yet
+	unsigned outstanding() const;
+
+	/// Wait until every submitted job has finished; returns false on timeout
+	bool wait(std::chrono::milliseconds timeout=std::chrono::milliseconds(2000)) const;
+
+	/// Returns the context to the pool early
+	void reset(){ if (m_afu) m_pool->release(m_afu); m_afu=nullptr; }
+
+	explicit operator bool() const { return m_afu != nullptr; }
+
+	AFU& operator*() const { return *m_afu; }
+	AFU* operator->() const { return m_afu; }
+
+private:
+	Lease(AFUContextPool* pool,AFU* afu) : m_pool(pool),m_afu(afu){}
+
+	AFUContextPool*	m_pool=nullptr;
+	AFU*			m_afu=nullptr;
+
+	friend class AFUContextPool;
+};
+
+#endif /* AFUCONTEXTPOOL_HPP_ */
@@ -0,0 +1,236 @@
+/*
+ * AFUDispatcher.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "AFUDispatcher.hpp"
+#include "LineCompare.hpp"
+
+#include <boost/align/is_aligned.hpp>
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+
+AFUDispatcher::AFUDispatcher(const std::string& devStr) :
+	m_afu(devStr.c_str())
+{
+	if (posix_memalign(&m_scratch,CacheLineBytes,2*CacheLineBytes) != 0)
+		throw std::bad_alloc();
+
+	// persistent chunked-mode job: the WED block is unused (left empty) and jobs are queued as chunks
+	m_afu.start();
+	if (m_afu.status() != BlockMapAFUBase::Waiting)
+	{
+		free(m_scratch);
+		throw AFU::InvalidDevice(devStr + " (AFU did not start)");
+	}
+
+	m_thread = std::thread(&AFUDispatcher::serve,this);
+}
+
+AFUDispatcher::~AFUDispatcher()
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stop=true;
+	}
+	m_cv.notify_one();
+	m_thread.join();
+
+	// the block map only finishes after a last chunk, so end it with a one-line copy between scratch lines
+	if (!m_failed)
+	{
+		m_afu.queueChunk(m_scratch,CacheLineBytes,static_cast<uint8_t*>(m_scratch)+CacheLineBytes,CacheLineBytes,true);
+
+		WaitPolicy w(m_afu.waitPolicy());
+		if (!w.until([this]{ return m_afu.status() == BlockMapAFUBase::Done; },m_timeout))
+			BLUELINK_TRACE(DispatcherShutdown);
+		m_afu.terminate();
+	}
+	m_afu.close();						// detach (resets the AFU if it's stuck) before the scratch lines go
+
+	free(m_scratch);
+}
+
+std::future<void> AFUDispatcher::submit(const void* src,uint64_t iSize,void* dst,uint64_t oSize)
+{
+	if(!boost::alignment::is_aligned(CacheLineBytes,src) || !boost::alignment::is_aligned(CacheLineBytes,dst))
+		throw std::logic_error("AFUDispatcher: unaligned job address");
+	if(iSize % CacheLineBytes != 0 || oSize % CacheLineBytes != 0)
+		throw std::logic_error("AFUDispatcher: unaligned job size");
+
+	Job j;
+	j.src = src;
+	j.iSize = iSize;
+	j.dst = dst;
+	j.oSize = oSize;
+	j.submitted = clock::now();
+
+	std::future<void> f = j.done.get_future();
+
+	if (m_failed)
+	{
+		finish(j,false);
+		return f;
+	}
+
+	// count before pushing so the consumer never sees the job without its count
+	const std::size_t d = ++m_depth;
+	for(std::size_t m=m_maxDepth; d > m && !m_maxDepth.compare_exchange_weak(m,d); ){}
+
+	m_queue.push(std::move(j));
+
+	// the service thread sets m_parked before its last look at the queue, so one of us always sees the other;
+	// the queue's release/acquire alone would let this load pass the push (store-load), hence the full fence
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_parked)
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_cv.notify_one();
+	}
+
+	return f;
+}
+
+void AFUDispatcher::park()
+{
+	unique_lock<mutex> L(m_mutex);
+	m_parked = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);	// pairs with the fence in submit()
+	m_cv.wait(L,[this]{ return m_stop || !m_queue.empty(); });
+	m_parked = false;
+}
+
+void AFUDispatcher::finish(Job& j,const bool ok)
+{
+	{
+		lock_guard<mutex> L(m_statsMutex);
+		if (ok)
+		{
+			++m_stats.jobs;
+			m_stats.inputBytes += j.iSize;
+			m_stats.outputBytes += j.oSize;
+			m_stats.turnaround.record(clock::now()-j.submitted);
+		}
+		else
+			++m_stats.failedJobs;
+	}
+
+	if (ok)
+		j.done.set_value();
+	else
+		j.done.set_exception(std::make_exception_ptr(Timeout()));
+}
+
+void AFUDispatcher::serve()
+{
+	const std::size_t maxInFlight = BlockMapAFUBase::ChunkQueueDepth+1;
+
+	std::deque<Job> inFlight;			// queued to the AFU, oldest first
+	unsigned nDone=0;					// completed, to compare with the AFU's counter
+	clock::time_point busySince;
+
+	for(;;)
+	{
+		// hand over jobs in order while the AFU has room (or fail them all once it has stopped responding)
+		Job j;
+		while((m_failed || inFlight.size() < maxInFlight) && m_queue.pop(j))
+		{
+			--m_depth;
+
+			if (m_failed)
+			{
+				finish(j,false);
+				continue;
+			}
+
+			if (inFlight.empty())
+				busySince = clock::now();
+
+			m_afu.queueChunk(j.src,j.iSize,j.dst,j.oSize,false);
+			j.queued = clock::now();
+
+			{
+				lock_guard<mutex> L(m_statsMutex);
+				m_stats.queueWait.record(j.queued-j.submitted);
+			}
+
+			inFlight.push_back(std::move(j));
+		}
+
+		if (inFlight.empty())
+		{
+			if (m_stop && m_depth == 0)
+				break;
+			park();
+			continue;
+		}
+
+		// wait for the oldest job, or for a new one if there's room for it on the AFU
+		const bool ok = m_afu.waitPolicy().until([&]
+			{
+				return m_afu.outputChunksDone() > nDone || (inFlight.size() < maxInFlight && !m_queue.empty());
+			},m_timeout);
+
+		if (!ok)
+		{
+			BLUELINK_TRACE(DispatcherTimeout,m_afu.outputChunksDone(),m_afu.inputTransferred(),m_afu.outputTransferred());
+
+			// the queued jobs may still be running: detach, which resets the AFU, so it can't touch their buffers once they're
+			// released to the callers below
+			m_afu.close();
+			m_failed = true;
+
+			for(Job& f : inFlight)
+				finish(f,false);
+			inFlight.clear();
+			continue;
+		}
+
+		for(const unsigned d = m_afu.outputChunksDone(); nDone < d && !inFlight.empty(); ++nDone)
+		{
+			finish(inFlight.front(),true);
+			inFlight.pop_front();
+		}
+
+		if (inFlight.empty())
+		{
+			lock_guard<mutex> L(m_statsMutex);
+			m_stats.afuSeconds += std::chrono::duration<double>(clock::now()-busySince).count();
+		}
+	}
+}
+
+AFUDispatcher::Stats AFUDispatcher::stats() const
+{
+	lock_guard<mutex> L(m_statsMutex);
+	Stats s = m_stats;
+	s.maxQueueDepth = m_maxDepth;
+	return s;
+}
+
+void AFUDispatcher::resetStats()
+{
+	lock_guard<mutex> L(m_statsMutex);
+	m_stats = Stats();
+	m_maxDepth = m_depth.load();
+}
+
+void AFUDispatcher::printStats(std::ostream& os) const
+{
+	const Stats s = stats();
+
+	os << "Jobs: " << s.jobs << " completed, " << s.failedJobs << " failed; " << s.inputBytes << " bytes in, " << s.outputBytes <<
+		" bytes out; " << fixed << setprecision(3) << s.afuSeconds << " s busy" << endl;
+	os << "Queue depth: " << queueDepth() << " now, " << s.maxQueueDepth << " peak" << endl;
+	os << "Queue wait (submit to AFU):" << endl;
+	s.queueWait.print(os);
+	os << "Turnaround (submit to output complete):" << endl;
+	s.turnaround.print(os);
+}
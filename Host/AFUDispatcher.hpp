@@ -0,0 +1,127 @@
+/*
+ * AFUDispatcher.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef AFUDISPATCHER_HPP_
+#define AFUDISPATCHER_HPP_
+
+#include <BlueLink/Host/BlockMapAFUBase.hpp>
+#include <BlueLink/Host/MPSCQueue.hpp>
+#include <BlueLink/Host/WaitPolicy.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** Shares one mkBlockMapAFU among any number of submitting threads.
+ *
+ * AFU and BlockMapAFUBase are single-threaded: nothing serializes MMIO, start or terminate. The dispatcher attaches once, runs
+ * the block map in chunked mode for its whole life, and owns the AFU from a single service thread. Threads submit jobs (a
+ * line-aligned input range to map into a line-aligned output range) through a lock-free MPSC queue; the service thread drains
+ * it in order and keeps the AFU's chunk queue full (ChunkQueueDepth+1 jobs in flight), queueing the next job as soon as one
+ * finishes, so the AFU is never short of work while jobs are queued. Jobs still don't fully overlap on the AFU:
+ * the next job's input is read and mapped ahead, but the write stream holds its output until the current job's writes are all
+ * acknowledged, so each job boundary costs about one memory round trip. Each job's future is fulfilled once its output is in
+ * host memory.
+ *
+ * Metrics: current and peak queue depth (submitted, not yet handed to the AFU), and histograms of queue wait (submit to
+ * queued on the AFU) and turnaround (submit to output complete).
+ *
+ * If the AFU stops responding, it is detached (which resets it, so it no longer accesses the buffers), then in-flight and later
+ * jobs fail with AFUDispatcher::Timeout.
+ */
+
+class AFUDispatcher
+{
+public:
+	explicit AFUDispatcher(const std::string& devStr);
+	~AFUDispatcher();					///< Completes all submitted jobs, then terminates the AFU
+
+	AFUDispatcher(const AFUDispatcher&) = delete;
+	AFUDispatcher& operator=(const AFUDispatcher&) = delete;
+
+	/** Map iSize input bytes at src to oSize output bytes at dst (both 128B-aligned, sizes multiples of 128). Callable from any
+	 * thread; neither buffer may be touched until the future is ready. Throws std::logic_error for unaligned jobs.
+	 */
+	std::future<void> submit(const void* src,uint64_t iSize,void* dst,uint64_t oSize);
+
+	void		timeout(std::chrono::milliseconds t){ m_timeout=t; }	///< Longest wait for any one job to complete
+	bool		failed() const { return m_failed; }
+
+	std::size_t	queueDepth() const { return m_depth; }				///< Jobs submitted but not yet queued on the AFU
+
+	struct Stats
+	{
+		uint64_t			jobs=0;				///< Completed successfully
+		uint64_t			failedJobs=0;
+		uint64_t			inputBytes=0;
+		uint64_t			outputBytes=0;
+		std::size_t			maxQueueDepth=0;
+		double				afuSeconds=0.0;		///< Time with at least one job in flight
+
+		LatencyHistogram	queueWait;			///< Submit to queued on the AFU
+		LatencyHistogram	turnaround;			///< Submit to output in host memory
+	};
+
+	Stats		stats() const;
+	void		resetStats();
+	void		printStats(std::ostream& os) const;
+
+	/// The AFU's wait policy is only safe to change before the first submit
+	BlockMapAFUBase& afu(){ return m_afu; }
+
+	class Timeout;
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	struct Job
+	{
+		const void*				src=nullptr;
+		uint64_t				iSize=0;
+		void*					dst=nullptr;
+		uint64_t				oSize=0;
+		clock::time_point		submitted;
+		clock::time_point		queued;
+		std::promise<void>		done;
+	};
+
+	void serve();
+	void park();
+	void finish(Job& j,bool ok);
+
+	BlockMapAFUBase				m_afu;
+
+	MPSCQueue<Job>				m_queue;
+	std::atomic<std::size_t>	m_depth{0};
+	std::atomic<std::size_t>	m_maxDepth{0};
+
+	std::mutex					m_mutex;				// only for parking the idle service thread
+	std::condition_variable		m_cv;
+	std::atomic<bool>			m_parked{false};
+	std::atomic<bool>			m_stop{false};
+	std::thread					m_thread;
+
+	std::chrono::milliseconds	m_timeout{2000};
+	std::atomic<bool>			m_failed{false};
+
+	mutable std::mutex			m_statsMutex;
+	Stats						m_stats;
+
+	void*						m_scratch=nullptr;		// source/destination of the final chunk queued on shutdown
+};
+
+class AFUDispatcher::Timeout : public std::exception {
+public:
+	Timeout(){}
+	virtual const char* what() const noexcept { return "AFUDispatcher::Timeout waiting for the AFU"; }
+};
+
+#endif /* AFUDISPATCHER_HPP_ */
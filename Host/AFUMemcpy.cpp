@@ -0,0 +1,445 @@
+/*
+ * AFUMemcpy.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "AFUMemcpy.hpp"
+#include "LineCompare.hpp"
+
+#include <boost/align/aligned_allocator.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+typedef std::chrono::steady_clock clock_type;
+
+AFUMemcpy::AFUMemcpy(const std::string& devStr) :
+	m_afu(devStr.c_str())
+{
+	if (posix_memalign(&m_scratch,CacheLineBytes,2*CacheLineBytes) != 0)
+		throw std::bad_alloc();
+
+	// persistent chunked-mode job: the WED block is unused (left empty) and copies are queued as chunks
+	m_afu.start();
+	if (m_afu.status() != BlockMapAFUBase::Waiting)
+	{
+		free(m_scratch);
+		throw AFU::InvalidDevice(devStr + " (AFU did not start)");
+	}
+
+	m_thread = std::thread(&AFUMemcpy::serve,this);
+}
+
+AFUMemcpy::~AFUMemcpy()
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stop=true;
+	}
+	m_cv.notify_one();
+	m_thread.join();
+
+	// the block map only finishes after a last chunk, so end it with a one-line copy between scratch lines
+	if (!m_failed)
+	{
+		m_afu.queueChunk(m_scratch,CacheLineBytes,static_cast<uint8_t*>(m_scratch)+CacheLineBytes,CacheLineBytes,true);
+
+		WaitPolicy w(m_afu.waitPolicy());
+		if (!w.until([this]{ return m_afu.status() == BlockMapAFUBase::Done; },m_timeout))
+			BLUELINK_TRACE(MemcpyShutdown);
+		m_afu.terminate();
+	}
+	m_afu.close();						// detach (resets the AFU if it's stuck) before the scratch lines go
+
+	free(m_scratch);
+}
+
+namespace {
+
+/// Fill n bytes with an 8-byte pattern, starting at byte phase of the pattern
+void fillPattern(uint8_t* p,std::size_t n,uint64_t pattern,std::size_t phase)
+{
+	uint8_t b[8];
+	memcpy(b,&pattern,8);
+
+	if (std::all_of(b,b+8,[&b](uint8_t x){ return x == b[0]; }))
+	{
+		memset(p,b[0],n);
+		return;
+	}
+
+	uint8_t r[8];
+	for(unsigned i=0;i<8;++i)
+		r[i] = b[(i+phase)%8];
+
+	std::size_t j=0;
+	for(;j+8<=n;j+=8)
+		memcpy(p+j,r,8);
+	memcpy(p+j,r,n-j);
+}
+
+/// Pattern as seen from byte phase (the pattern the AFU must write to a line starting there)
+uint64_t rotatePattern(uint64_t pattern,std::size_t phase)
+{
+	uint64_t r;
+	fillPattern(reinterpret_cast<uint8_t*>(&r),8,pattern,phase);
+	return r;
+}
+
+/// Unaligned head and line-aligned body of a range starting at p
+void splitLines(const void* p,std::size_t n,std::size_t& head,std::size_t& body)
+{
+	const std::size_t off = reinterpret_cast<uintptr_t>(p) % CacheLineBytes;
+	head = off == 0 ? 0 : std::min(n,CacheLineBytes-off);
+	body = (n-head)/CacheLineBytes*CacheLineBytes;
+}
+
+std::future<void> ready()
+{
+	std::promise<void> p;
+	p.set_value();
+	return p.get_future();
+}
+
+}
+
+std::future<void> AFUMemcpy::copy(void* dst,const void* src,std::size_t n)
+{
+	std::size_t head, body;
+	splitLines(src,n,head,body);
+
+	if (!m_failed && body > 0 && body >= m_threshold &&
+			reinterpret_cast<uintptr_t>(src) % CacheLineBytes == reinterpret_cast<uintptr_t>(dst) % CacheLineBytes)
+		return submit(Request{ Copy, dst, src, n, 0, std::promise<void>() });
+
+	cpuCopy(dst,src,n);
+	return ready();
+}
+
+std::future<void> AFUMemcpy::fill(void* dst,std::size_t n,uint64_t pattern)
+{
+	std::size_t head, body;
+	splitLines(dst,n,head,body);
+
+	if (!m_failed && body > 0 && body >= m_fillThreshold)
+		return submit(Request{ Fill, dst, nullptr, n, pattern, std::promise<void>() });
+
+	cpuFill(dst,n,pattern);
+	return ready();
+}
+
+std::future<void> AFUMemcpy::submit(Request&& r)
+{
+	std::future<void> f = r.done.get_future();
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_queue.push_back(std::move(r));
+		++m_pending;
+	}
+	m_cv.notify_one();
+	return f;
+}
+
+void AFUMemcpy::cpuCopy(void* dst,const void* src,std::size_t n)
+{
+	memcpy(dst,src,n);
+
+	lock_guard<mutex> L(m_statsMutex);
+	++m_stats.cpuCopies;
+	m_stats.cpuBytes += n;
+}
+
+void AFUMemcpy::cpuFill(void* dst,std::size_t n,uint64_t pattern)
+{
+	fillPattern(static_cast<uint8_t*>(dst),n,pattern,0);
+
+	lock_guard<mutex> L(m_statsMutex);
+	++m_stats.cpuFills;
+	m_stats.cpuFillBytes += n;
+}
+
+void AFUMemcpy::send(Request& r)
+{
+	std::size_t head, body;
+	splitLines(r.kind == Copy ? r.src : r.dst,r.n,head,body);
+
+	uint8_t* dst = static_cast<uint8_t*>(r.dst);
+	const std::size_t tail = r.n-head-body;
+
+	// queue the aligned body, then do the unaligned head and tail on the CPU while the AFU works
+	if (r.kind == Copy)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(r.src);
+
+		m_afu.queueChunk(src+head,body,dst+head,body,false);
+
+		memcpy(dst,src,head);
+		memcpy(dst+head+body,src+head+body,tail);
+	}
+	else
+	{
+		if (r.pattern == 0)
+			m_afu.queueFill(dst+head,body);
+		else
+			m_afu.queueFill(dst+head,body,rotatePattern(r.pattern,head%8));
+
+		fillPattern(dst,head,r.pattern,0);
+		fillPattern(dst+head+body,tail,r.pattern,(head+body)%8);
+	}
+
+	lock_guard<mutex> L(m_statsMutex);
+	(r.kind == Copy ? m_stats.cpuBytes : m_stats.cpuFillBytes) += head+tail;
+}
+
+void AFUMemcpy::serve()
+{
+	const std::size_t maxCopies = BlockMapAFUBase::ChunkQueueDepth+1, maxFills = BlockMapAFUBase::FillQueueDepth+1;
+
+	std::deque<Request> copies, fills;		// queued to the AFU, oldest first
+	unsigned nCopiesDone=0, nFillsDone=0;	// completed, to compare with the AFU's counters
+	clock_type::time_point busySince;
+
+	for(;;)
+	{
+		std::vector<Request*> toSend;
+		std::size_t stillPending;
+
+		{
+			unique_lock<mutex> L(m_mutex);
+			m_cv.wait(L,[&]{ return m_stop || !m_queue.empty() || !copies.empty() || !fills.empty(); });
+
+			if (m_stop && m_queue.empty() && copies.empty() && fills.empty())
+				break;
+
+			if (copies.empty() && fills.empty())
+				busySince = clock_type::now();
+
+			// in order, while the AFU has room for the next request
+			while(!m_queue.empty())
+			{
+				std::deque<Request>& q = m_queue.front().kind == Copy ? copies : fills;
+				if (!m_failed && q.size() >= (&q == &copies ? maxCopies : maxFills))
+					break;
+
+				q.push_back(std::move(m_queue.front()));
+				m_queue.pop_front();
+				--m_pending;
+				toSend.push_back(&q.back());
+			}
+			stillPending = m_pending;
+		}
+
+		// requests queued before a failure are done here rather than in copy()/fill()
+		if (m_failed)
+		{
+			for(Request& r : copies)
+			{
+				cpuCopy(r.dst,r.src,r.n);
+				r.done.set_value();
+			}
+			for(Request& r : fills)
+			{
+				cpuFill(r.dst,r.n,r.pattern);
+				r.done.set_value();
+			}
+			copies.clear();
+			fills.clear();
+			continue;
+		}
+
+		for(Request* r : toSend)
+			send(*r);
+
+		// wait for the oldest copy or fill, or for a new request (which may fit in the AFU's queues)
+		const bool ok = m_afu.waitPolicy().until([&]
+			{
+				return (!copies.empty() && m_afu.outputChunksDone() > nCopiesDone) ||
+					(!fills.empty() && m_afu.fillsDone() > nFillsDone) ||
+					m_pending > stillPending;
+			},m_timeout);
+
+		if (!ok)
+		{
+			fail(copies);
+			fail(fills);
+			continue;
+		}
+
+		auto complete = [this](std::deque<Request>& q,unsigned& nDone,unsigned d)
+		{
+			for(; nDone < d && !q.empty(); ++nDone)
+			{
+				Request& r = q.front();
+				std::size_t head, body;
+				splitLines(r.kind == Copy ? r.src : r.dst,r.n,head,body);
+
+				{
+					lock_guard<mutex> L(m_statsMutex);
+					++(r.kind == Copy ? m_stats.afuCopies : m_stats.afuFills);
+					(r.kind == Copy ? m_stats.afuBytes : m_stats.afuFillBytes) += body;
+				}
+
+				r.done.set_value();
+				q.pop_front();
+			}
+		};
+
+		if (!copies.empty())
+			complete(copies,nCopiesDone,m_afu.outputChunksDone());
+		if (!fills.empty())
+			complete(fills,nFillsDone,m_afu.fillsDone());
+
+		if (copies.empty() && fills.empty())
+		{
+			lock_guard<mutex> L(m_statsMutex);
+			m_stats.afuSeconds += std::chrono::duration<double>(clock_type::now()-busySince).count();
+		}
+	}
+}
+
+void AFUMemcpy::fail(std::deque<Request>& inFlight)
+{
+	if (!m_failed)
+	{
+		BLUELINK_TRACE(MemcpyTimeout,m_afu.outputChunksDone(),m_afu.fillsDone(),m_afu.inputTransferred(),m_afu.outputTransferred());
+
+		// the queued requests may still be running: detach, which resets the AFU, so it can't touch the buffers once they're
+		// released to the callers below
+		m_afu.close();
+	}
+
+	m_failed = true;
+
+	for(Request& r : inFlight)
+		r.done.set_exception(std::make_exception_ptr(Timeout()));
+	inFlight.clear();
+}
+
+std::size_t AFUMemcpy::calibrate(std::size_t maxBytes)
+{
+	vector<uint8_t,boost::alignment::aligned_allocator<uint8_t,CacheLineBytes>> src(maxBytes,0x5a), dst(maxBytes,0);
+
+	const std::size_t saved = m_threshold, savedFill = m_fillThreshold;
+	m_threshold = 0;
+	m_fillThreshold = 0;
+
+	// best of a few runs, after a warm-up that also faults in the pages
+	auto best = [](std::function<void()> f)
+	{
+		f();
+		clock_type::duration t = clock_type::duration::max();
+		for(unsigned i=0;i<3;++i)
+		{
+			const clock_type::time_point t0 = clock_type::now();
+			f();
+			t = std::min(t,clock_type::now()-t0);
+		}
+		return t;
+	};
+
+	// smallest size from which the AFU is faster at every larger size measured
+	const std::size_t never = std::numeric_limits<std::size_t>::max();
+	std::size_t threshold = never, fillThreshold = never;
+
+	auto update = [never](std::size_t& th,std::size_t n,clock_type::duration tCPU,clock_type::duration tAFU)
+		{ th = tAFU < tCPU ? std::min(th,n) : never; };
+
+	for(std::size_t n=std::size_t(1)<<12; n <= maxBytes && !m_failed; n <<= 2)
+	{
+		update(threshold,n,
+			best([&]{ memcpy(dst.data(),src.data(),n); }),
+			best([&]{ copy(dst.data(),src.data(),n).wait(); }));
+
+		update(fillThreshold,n,
+			best([&]{ memset(dst.data(),0,n); }),
+			best([&]{ fill(dst.data(),n).wait(); }));
+	}
+
+	m_threshold = m_failed ? saved : threshold;
+	m_fillThreshold = m_failed ? savedFill : fillThreshold;
+	resetStats();
+	return m_threshold;
+}
+
+AFUMemcpy::Stats AFUMemcpy::stats() const
+{
+	lock_guard<mutex> L(m_statsMutex);
+	return m_stats;
+}
+
+void AFUMemcpy::resetStats()
+{
+	lock_guard<mutex> L(m_statsMutex);
+	m_stats = Stats();
+}
+
+void AFUMemcpy::printStats(std::ostream& os) const
+{
+	const Stats s = stats();
+
+	os << "AFU: " << setw(8) << dec << s.afuCopies << " copies " << setw(14) << s.afuBytes << " bytes, " <<
+		setw(8) << s.afuFills << " fills " << setw(14) << s.afuFillBytes << " bytes  " <<
+		fixed << setprecision(2) << s.afuGBps() << " GB/s" << endl;
+	os << "CPU: " << setw(8) << s.cpuCopies << " copies " << setw(14) << s.cpuBytes << " bytes, " <<
+		setw(8) << s.cpuFills << " fills " << setw(14) << s.cpuFillBytes << " bytes (incl. unaligned ends)" << endl;
+
+	auto print = [&os](const char* what,std::size_t th)
+	{
+		os << what << " threshold: ";
+		if (th == std::numeric_limits<std::size_t>::max())
+			os << "none (CPU faster at all sizes)" << endl;
+		else
+			os << th << " bytes" << endl;
+	};
+	print("Copy",m_threshold);
+	print("Fill",m_fillThreshold);
+}
+
+AFUMemcpy* AFUMemcpy::instance()
+{
+	static std::unique_ptr<AFUMemcpy> svc;
+	static std::once_flag once;
+
+	std::call_once(once,[]
+	{
+		const char* dev = getenv("BLUELINK_MEMCPY_DEVICE");
+		try {
+			svc.reset(new AFUMemcpy(dev ? dev : "/dev/cxl/afu0.0d"));
+			svc->calibrate();
+		}
+		catch(std::exception&)
+		{
+			BLUELINK_TRACE(MemcpyUnavailable);		// the AFU traces why it couldn't attach or map
+			svc.reset();
+		}
+	});
+	return svc.get();
+}
+
+std::future<void> afu_memcpy_async(void* dst,const void* src,std::size_t n)
+{
+	if (AFUMemcpy* svc = AFUMemcpy::instance())
+		return svc->copy(dst,src,n);
+
+	memcpy(dst,src,n);
+	return ready();
+}
+
+std::future<void> afu_memset_async(void* dst,int c,std::size_t n)
+{
+	if (AFUMemcpy* svc = AFUMemcpy::instance())
+		return svc->fill(dst,n,uint64_t(uint8_t(c))*0x0101010101010101ULL);
+
+	memset(dst,c,n);
+	return ready();
+}
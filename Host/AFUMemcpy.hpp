@@ -0,0 +1,154 @@
+/*
+ * AFUMemcpy.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef AFUMEMCPY_HPP_
+#define AFUMEMCPY_HPP_
+
+#include <BlueLink/Host/BlockMapAFUBase.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** Asynchronous memcpy/memset offload to a streaming-copy AFU (Examples/AFUMemcpy, mkAFUMemcpyAFU, or "emu:blockmap").
+ *
+ * The service attaches once and keeps a chunked-mode block map running for its whole life; every copy becomes one chunk and
+ * every fill one fill command (zero_m, or Write_na of a pattern), so there is no per-request attach/WED cost. Requests are
+ * queued and handed to the AFU by a service thread, which keeps up to ChunkQueueDepth+1 chunks and FillQueueDepth+1 fills in
+ * flight and fulfils each future once the AFU's writes are in host memory.
+ *
+ * The AFU only writes whole cache lines, so a copy is offloaded only if src and dst have the same offset within a line, and a
+ * copy or fill only if at least threshold() (fillThreshold()) bytes remain after the unaligned head and tail, which the service
+ * thread does with memcpy/memset. Everything else is done on the CPU in the calling thread and returns a ready future. The
+ * thresholds are the sizes above which the AFU beats the CPU, as measured by calibrate().
+ *
+ * If the AFU stops responding, it is detached (which resets it, so it no longer accesses the buffers), then in-flight requests
+ * fail with AFUMemcpy::Timeout and all later ones fall back to the CPU.
+ */
+
+class AFUMemcpy
+{
+public:
+	explicit AFUMemcpy(const std::string& devStr);
+	~AFUMemcpy();					///< Completes all queued requests, then terminates the AFU
+
+	AFUMemcpy(const AFUMemcpy&) = delete;
+	AFUMemcpy& operator=(const AFUMemcpy&) = delete;
+
+	/// Copy n bytes from src to dst; neither buffer may be touched until the future is ready
+	std::future<void> copy(void* dst,const void* src,std::size_t n);
+
+	/// Fill n bytes at dst with the 8-byte pattern (host byte order, byte k of dst gets pattern byte k%8); 0 clears with zero_m
+	std::future<void> fill(void* dst,std::size_t n,uint64_t pattern=0);
+
+	/** Time the CPU and the AFU copying and clearing sizes from 4k up to maxBytes and set the thresholds where the AFU becomes
+	 * faster (SIZE_MAX if it never does). Must not be called while requests are outstanding. Resets the stats.
+	 * Returns the new copy threshold.
+	 */
+	std::size_t calibrate(std::size_t maxBytes=std::size_t(1)<<24);
+
+	void 		threshold(std::size_t n){ m_threshold=n; }
+	std::size_t threshold() const { return m_threshold; }
+
+	void 		fillThreshold(std::size_t n){ m_fillThreshold=n; }
+	std::size_t fillThreshold() const { return m_fillThreshold; }
+
+	void		timeout(std::chrono::milliseconds t){ m_timeout=t; }	///< Longest wait for any one request to complete
+
+	bool		failed() const { return m_failed; }		///< AFU timed out; everything goes to the CPU
+
+	struct Stats
+	{
+		uint64_t	afuCopies=0;
+		uint64_t	afuBytes=0;			///< Bytes copied by the AFU (excluding heads/tails)
+		uint64_t	afuFills=0;
+		uint64_t	afuFillBytes=0;		///< Bytes filled by the AFU (excluding heads/tails)
+		double		afuSeconds=0.0;		///< Time with at least one request in flight
+
+		uint64_t	cpuCopies=0;
+		uint64_t	cpuBytes=0;			///< Bytes copied by memcpy, including heads/tails of offloaded copies
+		uint64_t	cpuFills=0;
+		uint64_t	cpuFillBytes=0;		///< Bytes filled by the CPU, including heads/tails of offloaded fills
+
+		/// Bytes written by the AFU per second busy
+		double		afuGBps() const { return afuSeconds > 0 ? 1e-9*(afuBytes+afuFillBytes)/afuSeconds : 0.0; }
+	};
+
+	Stats		stats() const;
+	void		resetStats();
+	void		printStats(std::ostream& os) const;
+
+	BlockMapAFUBase& afu(){ return m_afu; }
+
+	/** Process-wide service used by afu_memcpy_async/afu_memset_async, opened on first use from $BLUELINK_MEMCPY_DEVICE
+	 * (default /dev/cxl/afu0.0d) and calibrated. Returns nullptr if the device can't be opened.
+	 */
+	static AFUMemcpy* instance();
+
+	class Timeout;
+
+private:
+	enum Kind { Copy, Fill };
+
+	struct Request
+	{
+		Kind					kind;
+		void*					dst;
+		const void*				src;
+		std::size_t				n;
+		uint64_t				pattern;
+		std::promise<void>		done;
+	};
+
+	std::future<void> submit(Request&& r);
+
+	void serve();
+	void send(Request& r);
+	void fail(std::deque<Request>& inFlight);
+
+	void cpuCopy(void* dst,const void* src,std::size_t n);
+	void cpuFill(void* dst,std::size_t n,uint64_t pattern);
+
+	BlockMapAFUBase				m_afu;
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_cv;
+	std::deque<Request>			m_queue;
+	bool						m_stop=false;
+	std::atomic<std::size_t>	m_pending{0};			// m_queue.size(), readable without the lock
+	std::thread					m_thread;
+
+	std::chrono::milliseconds	m_timeout{2000};
+
+	std::atomic<std::size_t>	m_threshold{std::size_t(1)<<20};
+	std::atomic<std::size_t>	m_fillThreshold{std::size_t(1)<<20};
+	std::atomic<bool>			m_failed{false};
+
+	mutable std::mutex			m_statsMutex;
+	Stats						m_stats;
+
+	void*						m_scratch=nullptr;		// source/destination of the final chunk queued on shutdown
+};
+
+class AFUMemcpy::Timeout : public std::exception {
+public:
+	Timeout(){}
+	virtual const char* what() const noexcept { return "AFUMemcpy::Timeout waiting for the AFU"; }
+};
+
+/// Copy using the process-wide AFUMemcpy service, or plain memcpy (returning a ready future) if there is none
+std::future<void> afu_memcpy_async(void* dst,const void* src,std::size_t n);
+
+/// As memset, using the process-wide AFUMemcpy service if there is one
+std::future<void> afu_memset_async(void* dst,int c,std::size_t n);
+
+#endif /* AFUMEMCPY_HPP_ */
@@ -0,0 +1,186 @@
+/*
+ * BSVLayout.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BSVLAYOUT_HPP_
+#define BSVLAYOUT_HPP_
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/** Field accessors for BSV deriving(Bits) structs as they sit in host memory, used by the layouts generated by
+ * Core/make_bsv_layout.pl.
+ *
+ * A packed BSV value of N bits is read/written by the AFU (WED segments via concatSegReg(..,LE), and stream data) as a
+ * big-endian bit vector starting at the lowest address: bit N-1 is the MSB of byte 0. Structs pack their first field at the MSB,
+ * so fields appear in declaration order; Vector#(n,t) packs element n-1 at the MSB, so elements appear in reverse order. Offsets
+ * here count bits from the MSB of byte 0. Multi-byte fields are big-endian in memory unless wrapped in LittleEndian# (see
+ * Core/Endianness.bsv), which stores them byte-reversed, ie. as native integers on a little-endian host.
+ *
+ * Byte-aligned fields of 8/16/32/64 bits are a single load/store (plus a byte swap for big-endian fields on a little-endian host);
+ * others are assembled from the bytes they span with constant shifts. Values are the raw field bits (Int#(n) is not
+ * sign-extended, enums are their encoding).
+ */
+
+namespace BSVLayout {
+
+/// Smallest unsigned type holding Width bits
+template<unsigned Width>using uint_for = typename std::conditional<Width <= 8,uint8_t,
+	typename std::conditional<Width <= 16,uint16_t,
+	typename std::conditional<Width <= 32,uint32_t,uint64_t>::type>::type>::type;
+
+namespace detail {
+
+inline uint64_t byteswap(uint64_t x,unsigned nBytes)
+{
+	return __builtin_bswap64(x) >> (64-8*nBytes);
+}
+
+constexpr bool hostLittleEndian()
+{
+	return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+}
+
+/// Width bits starting Offset bits from the MSB of p[0], MSB first
+template<std::size_t Offset,unsigned Width>inline uint64_t readBits(const uint8_t* p)
+{
+	if (Offset % 8 == 0 && (Width == 8 || Width == 16 || Width == 32 || Width == 64))
+	{
+		uint64_t x=0;
+		std::memcpy(&x,p+Offset/8,Width/8);		// little-endian host: byte 0 lands in the LS byte
+		return hostLittleEndian() ? byteswap(x,Width/8) : x >> (64-Width);
+	}
+
+	uint64_t x=0;
+	for(unsigned i=0;i<Width;)
+	{
+		const std::size_t pos = Offset+i;
+		const unsigned n = 8-pos%8 < Width-i ? 8-pos%8 : Width-i;
+		x = (x << n) | ((p[pos/8] >> (8-pos%8-n)) & ((1u << n)-1));
+		i += n;
+	}
+	return x;
+}
+
+template<std::size_t Offset,unsigned Width>inline void writeBits(uint8_t* p,uint64_t x)
+{
+	if (Offset % 8 == 0 && (Width == 8 || Width == 16 || Width == 32 || Width == 64))
+	{
+		if (hostLittleEndian())
+			x = byteswap(x,Width/8);
+		else
+			x <<= 64-Width;
+		std::memcpy(p+Offset/8,&x,Width/8);
+		return;
+	}
+
+	for(unsigned i=Width;i>0;)
+	{
+		const std::size_t pos = Offset+i-1;				// last bit still to write
+		const unsigned n = pos%8+1 < i ? pos%8+1 : i;	// bits of the field in this byte, ending at pos
+		const unsigned sh = 7-pos%8;
+		const uint8_t m = ((1u << n)-1) << sh;
+		p[pos/8] = (p[pos/8] & ~m) | ((x << sh) & m);
+		x >>= n;
+		i -= n;
+	}
+}
+
+}
+
+/// Scalar field of Width <= 64 bits at bit Offset; LE for LittleEndian# fields (Width a multiple of 8)
+template<std::size_t Offset,unsigned Width,bool LE=false>struct Field
+{
+	static_assert(Width >= 1 && Width <= 64,"BSVLayout::Field: width must be 1..64 bits (use Bytes for wider fields)");
+	static_assert(!LE || Width % 8 == 0,"BSVLayout::Field: LittleEndian# fields must be whole bytes");
+
+	typedef uint_for<Width> value_type;
+
+	static constexpr std::size_t	offset = Offset;
+	static constexpr unsigned		width = Width;
+	static constexpr bool			littleEndian = LE;
+	static constexpr std::size_t	end = Offset+Width;				///< Bit offset just past the field
+
+	static value_type get(const void* p)
+	{
+		const uint64_t x = detail::readBits<Offset,Width>(static_cast<const uint8_t*>(p));
+		return value_type(LE ? detail::byteswap(x,Width/8) : x);
+	}
+
+	static void set(void* p,uint64_t x)
+	{
+		x &= Width == 64 ? ~uint64_t(0) : (uint64_t(1) << (Width%64))-1;
+		detail::writeBits<Offset,Width>(static_cast<uint8_t*>(p),LE ? detail::byteswap(x,Width/8) : x);
+	}
+};
+
+/// Vector#(N,t) of scalars: element i is at Offset+(N-1-i)*Width
+template<std::size_t Offset,unsigned Width,std::size_t N,bool LE=false>struct ArrayField
+{
+	typedef uint_for<Width> value_type;
+
+	static constexpr std::size_t	offset = Offset;
+	static constexpr unsigned		width = Width;
+	static constexpr std::size_t	size = N;
+	static constexpr std::size_t	end = Offset+N*Width;
+
+	template<std::size_t I>using element = Field<Offset+(N-1-I)*Width,Width,LE>;
+
+	static value_type get(const void* p,std::size_t i)
+	{
+		const std::size_t pos = Offset+(N-1-i)*Width;
+		const uint8_t* b = static_cast<const uint8_t*>(p)+pos/8;
+
+		// dispatch to a single-field view with the element's bit offset within its first byte
+		switch(pos%8)
+		{
+		case 0: return Field<0,Width,LE>::get(b);
+		case 1: return Field<1,Width,LE>::get(b);
+		case 2: return Field<2,Width,LE>::get(b);
+		case 3: return Field<3,Width,LE>::get(b);
+		case 4: return Field<4,Width,LE>::get(b);
+		case 5: return Field<5,Width,LE>::get(b);
+		case 6: return Field<6,Width,LE>::get(b);
+		default: return Field<7,Width,LE>::get(b);
+		}
+	}
+
+	static void set(void* p,std::size_t i,uint64_t x)
+	{
+		const std::size_t pos = Offset+(N-1-i)*Width;
+		uint8_t* b = static_cast<uint8_t*>(p)+pos/8;
+
+		switch(pos%8)
+		{
+		case 0: Field<0,Width,LE>::set(b,x); break;
+		case 1: Field<1,Width,LE>::set(b,x); break;
+		case 2: Field<2,Width,LE>::set(b,x); break;
+		case 3: Field<3,Width,LE>::set(b,x); break;
+		case 4: Field<4,Width,LE>::set(b,x); break;
+		case 5: Field<5,Width,LE>::set(b,x); break;
+		case 6: Field<6,Width,LE>::set(b,x); break;
+		default: Field<7,Width,LE>::set(b,x); break;
+		}
+	}
+};
+
+/// Byte-aligned field wider than 64 bits (eg. Bit#(512)), accessed as raw memory
+template<std::size_t Offset,unsigned Width>struct Bytes
+{
+	static_assert(Offset % 8 == 0 && Width % 8 == 0,"BSVLayout::Bytes: wide fields must be byte-aligned");
+
+	static constexpr std::size_t	offset = Offset;
+	static constexpr unsigned		width = Width;
+	static constexpr std::size_t	end = Offset+Width;
+
+	static uint8_t*			data(void* p)		{ return static_cast<uint8_t*>(p)+Offset/8; }
+	static const uint8_t*	data(const void* p)	{ return static_cast<const uint8_t*>(p)+Offset/8; }
+};
+
+}
+
+#endif /* BSVLAYOUT_HPP_ */
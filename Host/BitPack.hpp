@@ -0,0 +1,243 @@
+/*
+ * BitPack.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BITPACK_HPP_
+#define BITPACK_HPP_
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/** Bulk conversion between arrays of native integers and cache lines of Bits-wide packed fields, as a Bluespec
+ * Vector#(LineBits/Bits,Bit#(Bits)) (or UInt/Int/FixedInt of that width) sees them: element k of each line occupies line bits
+ * [k*Bits,(k+1)*Bits), bit b of the line being bit b%8 of byte b/8 (little-endian host), and any bits left over at the top of
+ * the line are zero. This is the layout the per-element Packer/Unpacker produce for a std::array of FixedInt<T,Bits>, so the
+ * bulk versions can be used for homogeneous containers (see Examples/Endian) without going one field at a time.
+ *
+ * The field width is a template parameter, so every shift and mask is a constant and packing unrolls a whole line into registers. Unpacking
+ * uses AVX-512F (8 lanes) or AVX2 (4 lanes) variable shifts where available for fields up to 57b wide read into unsigned
+ * 64b elements; everything else, and packing, runs a word-at-a-time scalar kernel that compilers vectorize for byte-multiple
+ * widths (and on POWER8 VSX).
+ *
+ * Packing takes the low Bits bits of each value; unpacking sign-extends into signed T. Incomplete last lines are zero-padded.
+ */
+
+template<unsigned Bits,unsigned LineBits=1024>struct BitPackLayout
+{
+	static_assert(Bits >= 1 && Bits <= 64,"BitPackLayout: field width must be 1..64 bits");
+	static_assert(LineBits % 64 == 0 && LineBits >= Bits,"BitPackLayout: line must be a whole number of 64b words");
+
+	static constexpr unsigned		perLine = LineBits/Bits;		///< Fields per line
+	static constexpr unsigned		lineWords = LineBits/64;
+	static constexpr std::size_t	lineBytes = LineBits/8;
+
+	static constexpr uint64_t		mask = Bits == 64 ? ~uint64_t(0) : (uint64_t(1) << (Bits%64)) - 1;
+
+	/// Lines needed to hold n fields
+	static constexpr std::size_t lines(std::size_t n){ return (n+perLine-1)/perLine; }
+};
+
+namespace BitPackDetail {
+
+template<unsigned Bits,typename T>inline T widen(uint64_t x)
+{
+	return std::is_signed<T>::value && Bits < 64 ?
+		T(int64_t(x << (64-Bits%64)) >> (64-Bits%64)) :
+		T(x);
+}
+
+/// ORs fields [K,N) of a line into words w, unrolled at compile time so each lands in a register with constant shifts
+template<unsigned Bits,unsigned LineBits,typename T,unsigned K,unsigned N>struct PackFields
+{
+	static inline void apply(const T* src,uint64_t* w)
+	{
+		const uint64_t x = uint64_t(src[K]) & BitPackLayout<Bits,LineBits>::mask;
+		const unsigned i = K*Bits/64, s = K*Bits%64;
+
+		w[i] |= x << s;
+		if (s+Bits > 64)
+			w[i+1] |= x >> (64-s)%64;
+
+		PackFields<Bits,LineBits,T,K+1,N>::apply(src,w);
+	}
+};
+
+template<unsigned Bits,unsigned LineBits,typename T,unsigned N>struct PackFields<Bits,LineBits,T,N,N>
+{
+	static inline void apply(const T*,uint64_t*){}
+};
+
+/// Pack one full line
+template<unsigned Bits,unsigned LineBits,typename T>inline void packLine(const T* src,uint64_t* line)
+{
+	typedef BitPackLayout<Bits,LineBits> L;
+	uint64_t w[L::lineWords] = {0};
+
+	PackFields<Bits,LineBits,T,0,L::perLine>::apply(src,w);
+	std::memcpy(line,w,L::lineBytes);
+}
+
+/// Pack n < perLine values into a zero-padded line
+template<unsigned Bits,unsigned LineBits,typename T>inline void packPartialLine(const T* src,unsigned n,uint64_t* line)
+{
+	typedef BitPackLayout<Bits,LineBits> L;
+	uint64_t w[L::lineWords] = {0};
+
+	for(unsigned k=0;k<n;++k)
+	{
+		const uint64_t x = uint64_t(src[k]) & L::mask;
+		const unsigned b = k*Bits, i = b/64, s = b%64;
+
+		w[i] |= x << s;
+		if (s+Bits > 64)
+			w[i+1] |= x >> (64-s);
+	}
+	std::memcpy(line,w,L::lineBytes);
+}
+
+/// Unpack the first n fields of a line
+template<unsigned Bits,unsigned LineBits,typename T>inline void unpackPartialLine(const uint64_t* line,unsigned n,T* dst)
+{
+	typedef BitPackLayout<Bits,LineBits> L;
+
+	for(unsigned k=0;k<n;++k)
+	{
+		const unsigned b = k*Bits, i = b/64, s = b%64;
+		uint64_t x = line[i] >> s;
+
+		if (s+Bits > 64)
+			x |= line[i+1] << (64-s);
+
+		dst[k] = widen<Bits,T>(x & L::mask);
+	}
+}
+
+/// Unpacks fields [K,N) of a line, unrolled at compile time
+template<unsigned Bits,unsigned LineBits,typename T,unsigned K,unsigned N>struct UnpackFields
+{
+	static inline void apply(const uint64_t* line,T* dst)
+	{
+		const unsigned i = K*Bits/64, s = K*Bits%64;
+		uint64_t x = line[i] >> s;
+
+		if (s+Bits > 64)
+			x |= line[i+1] << (64-s)%64;
+
+		dst[K] = widen<Bits,T>(x & BitPackLayout<Bits,LineBits>::mask);
+
+		UnpackFields<Bits,LineBits,T,K+1,N>::apply(line,dst);
+	}
+};
+
+template<unsigned Bits,unsigned LineBits,typename T,unsigned N>struct UnpackFields<Bits,LineBits,T,N,N>
+{
+	static inline void apply(const uint64_t*,T*){}
+};
+
+/** Number of leading fields of a line that a Lanes-wide gather of unaligned 64b words can unpack: whole groups of Lanes whose
+ * last field fits in the 8 bytes from its first byte, and whose load stays inside the line.
+ */
+template<unsigned Bits,unsigned LineBits,unsigned Lanes>constexpr unsigned simdFields()
+{
+	return Bits > 57 ? 0 :
+		(BitPackLayout<Bits,LineBits>::lineBytes-8)*8/Bits+1 < BitPackLayout<Bits,LineBits>::perLine ?
+			((BitPackLayout<Bits,LineBits>::lineBytes-8)*8/Bits+1)/Lanes*Lanes :
+			BitPackLayout<Bits,LineBits>::perLine/Lanes*Lanes;
+}
+
+template<unsigned Bits,unsigned LineBits,typename T>struct UnpackKernel
+{
+	/// Unpack one full line
+	static void line(const uint64_t* src,T* dst){ UnpackFields<Bits,LineBits,T,0,BitPackLayout<Bits,LineBits>::perLine>::apply(src,dst); }
+};
+
+/** Unsigned 64b fields: each lane loads the unaligned 64b word starting at its field's first byte and shifts the field down.
+ * AVX-512F takes groups of 8, then AVX2 groups of 4 (which reach closer to the end of the line), then the scalar kernel.
+ */
+template<unsigned Bits,unsigned LineBits>struct UnpackKernel<Bits,LineBits,uint64_t>
+{
+	static void line(const uint64_t* src,uint64_t* dst)
+	{
+#if defined(__AVX2__)
+		// AVX-512F implies AVX2, and the AVX2 pass always finishes at or past the AVX-512F one
+		static constexpr unsigned kScalar = simdFields<Bits,LineBits,4>();
+		unsigned k=0;
+		const long long* base = reinterpret_cast<const long long*>(src);
+#else
+		static constexpr unsigned kScalar = 0;
+#endif
+
+#if defined(__AVX512F__)
+		{
+			const __m512i step = _mm512_set1_epi64(8*Bits);
+			const __m512i mask = _mm512_set1_epi64(BitPackLayout<Bits,LineBits>::mask);
+			const __m512i seven = _mm512_set1_epi64(7);
+			__m512i bit = _mm512_setr_epi64(0,Bits,2*Bits,3*Bits,4*Bits,5*Bits,6*Bits,7*Bits);
+
+			for(; k<simdFields<Bits,LineBits,8>(); k+=8)
+			{
+				const __m512i x = _mm512_i64gather_epi64(_mm512_srli_epi64(bit,3),base,1);
+				_mm512_storeu_si512(dst+k,_mm512_and_si512(_mm512_srlv_epi64(x,_mm512_and_si512(bit,seven)),mask));
+				bit = _mm512_add_epi64(bit,step);
+			}
+		}
+#endif
+
+#if defined(__AVX2__)
+		{
+			const __m256i step = _mm256_set1_epi64x(4*Bits);
+			const __m256i mask = _mm256_set1_epi64x(BitPackLayout<Bits,LineBits>::mask);
+			const __m256i seven = _mm256_set1_epi64x(7);
+			__m256i bit = _mm256_add_epi64(_mm256_setr_epi64x(0,Bits,2*Bits,3*Bits),_mm256_set1_epi64x(k*Bits));
+
+			for(; k<simdFields<Bits,LineBits,4>(); k+=4)
+			{
+				const __m256i x = _mm256_i64gather_epi64(base,_mm256_srli_epi64(bit,3),1);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst+k),
+					_mm256_and_si256(_mm256_srlv_epi64(x,_mm256_and_si256(bit,seven)),mask));
+				bit = _mm256_add_epi64(bit,step);
+			}
+		}
+#endif
+
+		UnpackFields<Bits,LineBits,uint64_t,kScalar,BitPackLayout<Bits,LineBits>::perLine>::apply(src,dst);
+	}
+};
+
+}
+
+/// Pack n values from src into BitPackLayout<Bits,LineBits>::lines(n) lines at dst (8B-aligned)
+template<unsigned Bits,unsigned LineBits=1024,typename T>void bitpack_lines(const T* src,std::size_t n,void* dst)
+{
+	typedef BitPackLayout<Bits,LineBits> L;
+	uint64_t* o = static_cast<uint64_t*>(dst);
+
+	for(; n >= L::perLine; n -= L::perLine, src += L::perLine, o += L::lineWords)
+		BitPackDetail::packLine<Bits,LineBits,T>(src,o);
+
+	if (n)
+		BitPackDetail::packPartialLine<Bits,LineBits,T>(src,n,o);
+}
+
+/// Unpack n values from the lines at src (8B-aligned) into dst
+template<unsigned Bits,unsigned LineBits=1024,typename T>void bitunpack_lines(const void* src,std::size_t n,T* dst)
+{
+	typedef BitPackLayout<Bits,LineBits> L;
+	const uint64_t* i = static_cast<const uint64_t*>(src);
+
+	for(; n >= L::perLine; n -= L::perLine, dst += L::perLine, i += L::lineWords)
+		BitPackDetail::UnpackKernel<Bits,LineBits,T>::line(i,dst);
+
+	if (n)
+		BitPackDetail::unpackPartialLine<Bits,LineBits,T>(i,n,dst);
+}
+
+#endif /* BITPACK_HPP_ */
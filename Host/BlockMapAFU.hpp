@@ -18,6 +18,15 @@
 #include <iomanip>
 #include <functional>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
 
 #include <BlueLink/Host/AFU.hpp>
 #include <BlueLink/Host/WED.hpp>
@@ -34,81 +43,501 @@
 #include <boost/range.hpp>
 
 #include "BlockMapAFUBase.hpp"
+#include "BufferArena.hpp"
+#include "MappedFile.hpp"
+#include "LineCompare.hpp"
 
 using namespace std;
 
+/// True if TestFixture declares static constexpr bool bit_exact_output=true
+template<class TestFixture,class Enable=void>struct has_bit_exact_output : std::false_type {};
+template<class TestFixture>struct has_bit_exact_output<TestFixture,typename std::enable_if<TestFixture::bit_exact_output>::type> :
+	std::true_type {};
+
+/// True if Checker provides merge(const Checker&) to fold in the results of another copy
+template<class Checker,class Enable=void>struct has_checker_merge : std::false_type {};
+template<class Checker>struct has_checker_merge<Checker,
+	decltype(void(std::declval<Checker&>().merge(std::declval<const Checker&>())))> : std::true_type {};
+
+/// Throughput/overhead estimates used to split hybrid CPU/AFU jobs (0 = not yet measured)
+struct HybridEstimate
+{
+	double		cpuRate=0.0;		// elements/s over all CPU threads
+	double		afuRate=0.0;		// elements/s streaming through the AFU(s)
+	double		afuOverhead=0.0;	// seconds of attach, WED read and terminate per job
+	std::mutex	mutex;
+};
+
+/** Host side of a mkBlockMapAFU instance.
+ *
+ * Input and output buffers are recycled across jobs through a BufferArena, so repeated same-shaped jobs don't pay allocation,
+ * zeroing and page faults each time. Input can be filled in place (borrowInput/resizeInput + input()) or handed over as a vector.
+ * The output is zeroed before each run unless disabled by zeroOutput(false) (useful when the AFU writes every element). With
+ * zeroOutputOnAFU(true), start() has the AFU clear it with zero_m after attaching instead of the CPU memset-ing it (whole-block
+ * mode only; chunked and hybrid runs still zero on the CPU). If that fill doesn't finish within the run timeout plus 1 ns per
+ * output byte, start() resets the AFU and throws std::runtime_error rather than let the map write into a range still being cleared.
+ *
+ * Input and output can also be file regions mapped with MappedFile, which the AFU then reads and writes in place, so on-disk
+ * datasets stream through with no intermediate copies. Transfer sizes that aren't a whole number of cache lines are padded up
+ * to the next line when the storage has room for it (mapped files and arena buffers always do).
+ *
+ * With a profiler set (see BlockMapAFUBase::profiler), the host phases (output preparation, packing and consuming chunks, CPU
+ * map, check) are recorded alongside attach/run and the AFU's own timestamps.
+ */
+
 template<class TestFixture>class BlockMapAFU : public BlockMapAFUBase
 {
 public:
+	typedef typename TestFixture::input_container_type		input_type;
+	typedef typename TestFixture::output_container_type		output_type;
+
 	typedef std::vector<
-			typename TestFixture::input_container_type,
-			boost::alignment::aligned_allocator<typename TestFixture::input_container_type,128>>
+			input_type,
+			boost::alignment::aligned_allocator<input_type,128>>
 			input_vector;
 
 	typedef std::vector<
-			typename TestFixture::output_container_type,
-			boost::alignment::aligned_allocator<typename TestFixture::output_container_type,128>>
+			output_type,
+			boost::alignment::aligned_allocator<output_type,128>>
 			output_vector;
 
-	BlockMapAFU(const char* devStr) : BlockMapAFUBase(devStr){}
+	BlockMapAFU(const char* devStr,const PinnedAllocPolicy& bufPolicy=PinnedAllocPolicy()) :
+		BlockMapAFUBase(devStr),
+		m_arena(bufPolicy){}
+
+	/// A job that timed out may still be running, so the AFU is detached before the buffers it writes are freed
+	~BlockMapAFU(){ detach(); }
+
 	void start();
 
-	bool check();
+	/** Checks output against input with the fixture's checker, using nThreads threads.
+	 *
+	 * Each thread checks a contiguous range with its own copy of the (cleared) checker. If the checker provides
+	 * merge(const Checker&), the copies are merged back into fixture.checker in range order, so accumulated statistics are the
+	 * same as for a single thread; such a checker's check() must not print, since it runs concurrently. A checker without merge()
+	 * is always run on one thread, directly on fixture.checker.
+	 *
+	 * If the fixture declares static constexpr bool bit_exact_output=true and provides const output_type* expectedOutput()
+	 * (packed golden output, same layout as the AFU's), the raw output is compared to it line-by-line instead of unpacking.
+	 */
+	bool check(unsigned nThreads=1);
 
-	void resizeInput(std::size_t N){ m_packedInput.resize(N); }
+	void resizeInput(std::size_t N);									///< Resize input, preserving contents
+	boost::iterator_range<input_type*> borrowInput(std::size_t N);		///< Resize input to N elements with unspecified contents
 
-	boost::iterator_range<typename input_vector::iterator> 			input() { return m_packedInput; }
-	boost::iterator_range<typename input_vector::const_iterator> 	input() const { return m_packedInput; }
+	boost::iterator_range<input_type*> 			input() 		{ return boost::iterator_range<input_type*>(m_input,m_input+m_nInput); }
+	boost::iterator_range<const input_type*> 	input() const 	{ return boost::iterator_range<const input_type*>(m_input,m_input+m_nInput); }
 
-	void input(
-			std::vector<
-				typename TestFixture::input_container_type,
-				boost::alignment::aligned_allocator<
-					typename TestFixture::input_container_type,
-					128>>&& v)
-	{
-		m_packedInput = std::move(v);
-	}
+	boost::iterator_range<const output_type*>	output() const
+		{ return boost::iterator_range<const output_type*>(outputData(),outputData()+m_nInput); }
+
+	void input(input_vector&& v);										///< Take ownership of v as the input (no copy)
+	void input(MappedFile& f);											///< Use a mapped (Read) file region in place as the input
+
+	/** Write output in place to a mapped (Write) file region instead of an arena buffer, until releaseBuffers(). The region must
+	 * hold the output for the current input size. A newly created file reads as zero already, so zeroOutput(false) avoids
+	 * clearing it again.
+	 */
+	void output(MappedFile& f);
+
+	void zeroOutput(bool z){ m_zeroOutput=z; }
+	void zeroOutputOnAFU(bool z){ m_afuZero=z; }
+
+	/** Chunked, pipelined run (replaces start/run; call terminate afterwards as usual).
+	 *
+	 * Streams nChunks chunks of up to chunkElements elements through the AFU using nSlots (<= ChunkQueueDepth+1) rotating
+	 * input/output buffers, so the host packs chunk k+1 and consumes chunk k-1 while the AFU processes chunk k. Memory use is
+	 * bounded by the slots regardless of dataset size.
+	 *
+	 *   std::size_t pack(std::size_t k,boost::iterator_range<input_type*> buf)			fill buf, return element count
+	 *   void consume(std::size_t k,boost::iterator_range<const input_type*> in,boost::iterator_range<const output_type*> out)
+	 *
+	 * Each chunk's size in bytes (input and output) must be a multiple of 128. Returns false on timeout.
+	 */
+	template<class Pack,class Consume>bool runChunked(std::size_t nChunks,std::size_t chunkElements,Pack&& pack,Consume&& consume,
+		unsigned nSlots=ChunkQueueDepth+1);
+
+	/** Hybrid CPU/AFU execution (replaces start/run/terminate).
+	 *
+	 * f(in,out,n) must compute the same packed output as the AFU for n elements. Each job is split so that both sides finish
+	 * together, using throughput and AFU fixed-overhead estimates measured on previous jobs (shared by all instances with the
+	 * same fixture): the AFU takes the first part (rounded to whole cache lines), nThreads CPU threads the rest. Jobs too small
+	 * to pay back the AFU overhead run entirely on the CPU. Until the AFU has been measured, jobs run entirely on the CPU, except
+	 * that the first one of at least hybridCalibrationSize elements is split evenly to calibrate both sides.
+	 *
+	 * If the AFU part fails or times out, the AFU is reset (see BlockMapAFUBase::reset) and its range is mapped on the CPU
+	 * instead, so the job still completes. Returns false only if that fallback couldn't run.
+	 */
+	typedef std::function<void(const input_type*,output_type*,std::size_t)> CPUMap;
+
+	void cpuMap(CPUMap f,unsigned nThreads=std::thread::hardware_concurrency()){ m_cpuMap=f; m_cpuThreads=std::max(1U,nThreads); }
+	bool runHybrid();
+
+	void hybridCalibrationSize(std::size_t n){ m_hybridCalibrationSize=n; }	///< Smallest job used to measure the AFU
+
+	static HybridEstimate& hybridEstimate(){ static HybridEstimate e; return e; }
+
+	void releaseBuffers();												///< Return input & output buffers to the arena
+	BufferArena& arena(){ return m_arena; }
 
 	TestFixture fixture;
 
 private:
 	unsigned m_maxErrorsToPrint=4096;
+	bool m_zeroOutput=true;
+	bool m_afuZero=false;
+
+	BufferArena				m_arena;		// declared before the blocks so it outlives them
+
+	BufferArena::Block		m_inBlock;
+	BufferArena::Block		m_outBlock;
+	input_vector			m_ownedInput;	// input handed over by input(input_vector&&)
+
+	input_type*				m_input=nullptr;
+	std::size_t				m_nInput=0;
+
+	std::size_t				m_inFileBytes=0;		// padded size of the mapped input region (if input is a MappedFile)
+	output_type*			m_outFile=nullptr;		// mapped output region, or nullptr to use m_outBlock
+	std::size_t				m_outFileBytes=0;
+
+	output_type*		outputData()		{ return m_outFile ? m_outFile : m_outBlock.as<output_type>(); }
+	const output_type*	outputData() const	{ return m_outFile ? m_outFile : m_outBlock.as<const output_type>(); }
 
-	std::vector<
-		typename TestFixture::input_container_type,
-		boost::alignment::aligned_allocator<typename TestFixture::input_container_type,128>> 	m_packedInput;
+	/// Bytes accessible from the start of the input/output storage
+	std::size_t inputCapacity() const;
+	std::size_t outputCapacity() const { return m_outFile ? m_outFileBytes : m_outBlock.capacity(); }
 
-	std::vector<
-		typename TestFixture::output_container_type,
-		boost::alignment::aligned_allocator<typename TestFixture::output_container_type,128>> 	m_packedOutput;
+	/// Transfer size rounded up to a whole cache line if the storage has room, else unchanged (and rejected by start)
+	static std::size_t paddedBytes(std::size_t bytes,std::size_t capacity)
+		{ return (bytes+127)/128*128 <= capacity ? (bytes+127)/128*128 : bytes; }
+
+	CPUMap					m_cpuMap;
+	unsigned				m_cpuThreads=1;
+	std::size_t				m_hybridCalibrationSize=std::size_t(1)<<20;
+
+	/// Map [i0,i1) on the CPU with up to m_cpuThreads threads, appended to threads
+	void cpuMapRange(std::vector<std::thread>& threads,std::size_t i0,std::size_t i1);
+
+	void prepareOutput(bool cpuZero=true);
+	void setWED(std::size_t N);
+
+	/// Smallest element count whose input and output are both whole cache lines (lcm of the per-side counts)
+	static constexpr std::size_t gcd(std::size_t a,std::size_t b){ return b == 0 ? a : gcd(b,a%b); }
+	static constexpr std::size_t linesPer(std::size_t bytes){ return CacheLineBytes/gcd(CacheLineBytes,bytes); }
+	static constexpr std::size_t afuUnit()
+		{ return linesPer(sizeof(input_type))/gcd(linesPer(sizeof(input_type)),linesPer(sizeof(output_type)))*linesPer(sizeof(output_type)); }
+
+	template<class Checker>unsigned checkRange(std::size_t i0,std::size_t i1,Checker& checker,std::vector<std::size_t>& errIdx,
+		bool printNow);
+	unsigned checkRangeExact(std::size_t i0,std::size_t i1,std::vector<std::size_t>& errIdx);
+
+	template<class Checker>unsigned checkChunk(std::size_t i0,std::size_t i1,Checker& checker,std::vector<std::size_t>& errIdx,
+		std::false_type){ return checkRange(i0,i1,checker,errIdx,false); }
+	template<class Checker>unsigned checkChunk(std::size_t i0,std::size_t i1,Checker&,std::vector<std::size_t>& errIdx,
+		std::true_type){ return checkRangeExact(i0,i1,errIdx); }
+
+	template<class Checker>void mergeCheckers(const std::vector<Checker>& checkers,std::true_type)
+		{ for(const Checker& c : checkers) fixture.checker.merge(c); }
+	template<class Checker>void mergeCheckers(const std::vector<Checker>&,std::false_type){}
 };
 
+template<class TestFixture>void BlockMapAFU<TestFixture>::input(input_vector&& v)
+{
+	m_inBlock.release();
+	m_ownedInput = std::move(v);
+	m_input = m_ownedInput.data();
+	m_nInput = m_ownedInput.size();
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::resizeInput(std::size_t N)
+{
+	if (m_input && m_input == m_ownedInput.data())
+	{
+		m_ownedInput.resize(N);
+		m_input = m_ownedInput.data();
+	}
+	else if (N*sizeof(input_type) > m_inBlock.capacity())
+	{
+		BufferArena::Block b = m_arena.acquire(N*sizeof(input_type));
+		std::copy(m_input,m_input+std::min(N,m_nInput),b.as<input_type>());
+		m_inBlock = std::move(b);
+		m_input = m_inBlock.as<input_type>();
+	}
+	m_nInput = N;
+}
+
+template<class TestFixture>boost::iterator_range<typename BlockMapAFU<TestFixture>::input_type*> BlockMapAFU<TestFixture>::borrowInput(std::size_t N)
+{
+	m_ownedInput = input_vector();
+
+	if (N*sizeof(input_type) > m_inBlock.capacity())
+		m_inBlock = m_arena.acquire(N*sizeof(input_type));
+
+	m_input = m_inBlock.as<input_type>();
+	m_nInput = N;
+	return input();
+}
+
+template<class TestFixture>template<class Pack,class Consume>bool BlockMapAFU<TestFixture>::runChunked(std::size_t nChunks,
+		std::size_t chunkElements,Pack&& pack,Consume&& consume,unsigned nSlots)
+{
+	nSlots = std::max(1U,std::min(nSlots,ChunkQueueDepth+1));
+
+	std::vector<BufferArena::Block> iSlot, oSlot;
+	std::vector<std::size_t> n(nSlots,0);
+
+	for(unsigned i=0;i<nSlots;++i)
+	{
+		iSlot.emplace_back(m_arena.acquire(chunkElements*sizeof(input_type)));
+		oSlot.emplace_back(m_arena.acquire(chunkElements*sizeof(output_type)));
+	}
+
+	// WED block is unused in chunked mode but must still be valid
+	m_wed->param.src = iSlot[0].data();
+	m_wed->param.iSize = 0;
+	m_wed->param.dst = oSlot[0].data();
+	m_wed->param.oSize = 0;
+
+	BlockMapAFUBase::start();
+
+	std::size_t kQueued=0;
+
+	for(std::size_t kDone=0;kDone<nChunks;++kDone)
+	{
+		// keep the AFU fed: pack and queue ahead while there are free slots
+		for(;kQueued < nChunks && kQueued-kDone < nSlots; ++kQueued)
+		{
+			Profiler::Span sp(profiler(),"pack");
+			const unsigned s = kQueued % nSlots;
+			n[s] = pack(kQueued,iSlot[s].template span<input_type>(chunkElements));
+
+			if (m_zeroOutput)
+				memset(oSlot[s].data(),0,n[s]*sizeof(output_type));
+
+			queueChunk(iSlot[s].data(),n[s]*sizeof(input_type),oSlot[s].data(),n[s]*sizeof(output_type),kQueued == nChunks-1);
+		}
+
+		if (!awaitOutputChunks(kDone+1))
+			return false;
+
+		Profiler::Span sp(profiler(),"consume");
+		const unsigned s = kDone % nSlots;
+		consume(kDone,
+			boost::iterator_range<const input_type*>(iSlot[s].template as<const input_type>(),iSlot[s].template as<const input_type>()+n[s]),
+			boost::iterator_range<const output_type*>(oSlot[s].template as<const output_type>(),oSlot[s].template as<const output_type>()+n[s]));
+	}
+	recordTimestamps();
+	return true;
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::input(MappedFile& f)
+{
+	if (f.size() % sizeof(input_type) != 0)
+		throw std::logic_error("BlockMapAFU: mapped input is not a whole number of elements");
+
+	m_inBlock.release();
+	m_ownedInput = input_vector();
+	m_input = f.as<input_type>();
+	m_nInput = f.size()/sizeof(input_type);
+	m_inFileBytes = f.paddedSize();
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::output(MappedFile& f)
+{
+	m_outBlock.release();
+	m_outFile = f.as<output_type>();
+	m_outFileBytes = f.paddedSize();
+}
+
+template<class TestFixture>std::size_t BlockMapAFU<TestFixture>::inputCapacity() const
+{
+	if (m_input && m_input == m_inBlock.as<const input_type>())
+		return m_inBlock.capacity();
+	else if (m_input && m_input == m_ownedInput.data())
+		return m_ownedInput.capacity()*sizeof(input_type);
+	else
+		return m_inFileBytes;
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::releaseBuffers()
+{
+	m_inBlock.release();
+	m_outBlock.release();
+	m_ownedInput = input_vector();
+	m_input = nullptr;
+	m_nInput = 0;
+	m_inFileBytes = 0;
+	m_outFile = nullptr;
+	m_outFileBytes = 0;
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::prepareOutput(bool cpuZero)
+{
+	Profiler::Span sp(profiler(),"prepare output");
+	const std::size_t oBytes = m_nInput*sizeof(output_type);
+
+	// get (recycled) output buffer unless writing to a file, and blank it unless disabled
+	if (m_outFile && oBytes > m_outFileBytes)
+		throw std::logic_error("BlockMapAFU: mapped output region is too small for the input");
+	else if (!m_outFile && oBytes > m_outBlock.capacity())
+		m_outBlock = m_arena.acquire(oBytes);
+
+	if (m_zeroOutput && cpuZero)
+		memset(outputData(),0,oBytes);
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::setWED(std::size_t N)
+{
+	m_wed->param.src = m_input;
+	m_wed->param.iSize = paddedBytes(sizeof(input_type)*N,inputCapacity());
+	m_wed->param.dst = outputData();
+	m_wed->param.oSize = paddedBytes(sizeof(output_type)*N,outputCapacity());
+}
+
 template<class TestFixture>void BlockMapAFU<TestFixture>::start()
 {
-	// allocate and blank the output vector
-	m_packedOutput.resize(m_packedInput.size());
-	memset(m_packedOutput.data(),0,m_packedOutput.size()*sizeof(typename TestFixture::output_container_type));
+	prepareOutput(!m_afuZero);
+	setWED(m_nInput);
+	const std::size_t oBytes = m_wed->param.oSize;		// whole output (the WED holds only the first shard's part after start)
 
-	// set up WED
-	m_wed->param.src = m_packedInput.data();
-	m_wed->param.iSize = sizeof(typename TestFixture::input_container_type)*m_packedInput.size();
-	m_wed->param.dst = m_packedOutput.data();
-	m_wed->param.oSize = sizeof(typename TestFixture::output_container_type)*m_packedInput.size();
+	BlockMapAFUBase::start();			// shards across cards, applies stream tuning, syncs the profiler clock
 
-	AFU::start(m_wed.get());
+	// output storage always has room to clear to the end of the last line (oSize is padded); the first card clears all of it,
+	// including the other shards' ranges, before any card starts
+	// the map must not start writing while the fill may still be clearing, so a fill that doesn't finish stops the AFU; the
+	// timeout allows for the size on top of the run timeout (at 1 GB/s, well under what zero_m achieves)
+	if (m_zeroOutput && m_afuZero)
+	{
+		Profiler::Span sp(profiler(),"AFU zero fill");
+		queueFill(outputData(),oBytes);
+		if (!awaitFills(1,runTimeout() + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(oBytes))))
+		{
+			reset();
+			throw std::runtime_error("BlockMapAFU::start: AFU zero fill of the output timed out");
+		}
+	}
 }
 
-template<class TestFixture>bool BlockMapAFU<TestFixture>::check()
+template<class TestFixture>bool BlockMapAFU<TestFixture>::runHybrid()
+{
+	typedef std::chrono::steady_clock clock;
+
+	if (!m_cpuMap)
+		throw std::logic_error("BlockMapAFU::runHybrid called without a CPU map function");
+
+	prepareOutput();
+
+	const std::size_t N = m_nInput;
+	HybridEstimate& est = hybridEstimate();
+
+	double cpuRate, afuRate, overhead;
+	{
+		std::lock_guard<std::mutex> L(est.mutex);
+		cpuRate = est.cpuRate;
+		afuRate = est.afuRate;
+		overhead = est.afuOverhead;
+	}
+
+	// finish both sides together: overhead + nAFU/afuRate = (N-nAFU)/cpuRate; nAFU <= 0 means the CPU alone is faster
+	// uncalibrated: CPU only, unless the job is big enough to be worth splitting evenly to measure both sides
+	double x = N >= m_hybridCalibrationSize ? N/2 : 0;
+	if (cpuRate > 0 && afuRate > 0)
+		x = (N/cpuRate - overhead) / (1.0/afuRate + 1.0/cpuRate);
+
+	const std::size_t nAFU = x <= 0 ? 0 : std::min(N,std::size_t(x))/afuUnit()*afuUnit();
+	const std::size_t nCPU = N-nAFU;
+
+	// CPU part in the background
+	std::vector<std::thread> threads;
+	const clock::time_point tc0 = clock::now();
+
+	cpuMapRange(threads,nAFU,N);
+
+	// AFU part in the foreground
+	bool ok=true;
+	clock::duration tAttach{}, tRun{};
+
+	if (nAFU)
+	{
+		setWED(nAFU);
+
+		const clock::time_point t0 = clock::now();
+		BlockMapAFUBase::start();
+		const clock::time_point t1 = clock::now();
+		BlockMapAFUBase::run();
+		ok = status() == Done;
+		const clock::time_point t2 = clock::now();
+		terminate();
+
+		tAttach = (t1-t0) + (clock::now()-t2);
+		tRun = t2-t1;
+	}
+
+	for(auto& t : threads)
+		t.join();
+	const clock::duration tCPU = clock::now()-tc0;
+
+	// AFU part failed: detach so it can't write any more, then redo its range on the CPU
+	bool fellBack=false;
+	if (!ok)
+	{
+		BLUELINK_TRACE(HybridFallback,nAFU);
+		try
+		{
+			reset();
+			threads.clear();
+			cpuMapRange(threads,0,nAFU);
+			for(auto& t : threads)
+				t.join();
+			fellBack=true;
+		}
+		catch(std::exception&)
+		{
+			for(auto& t : threads)
+				if (t.joinable())
+					t.join();
+		}
+	}
+
+	// update estimates (exponentially weighted) from sides that did enough work to time
+	auto ewma = [](double& e,double x){ e = e > 0 ? 0.5*e + 0.5*x : x; };
+	{
+		std::lock_guard<std::mutex> L(est.mutex);
+
+		if (nCPU >= 1024)
+			ewma(est.cpuRate,nCPU/std::chrono::duration<double>(tCPU).count());
+		if (nAFU >= 1024 && ok)
+		{
+			ewma(est.afuRate,nAFU/std::chrono::duration<double>(tRun).count());
+			ewma(est.afuOverhead,std::chrono::duration<double>(tAttach).count());
+		}
+	}
+	return ok || fellBack;
+}
+
+template<class TestFixture>void BlockMapAFU<TestFixture>::cpuMapRange(std::vector<std::thread>& threads,std::size_t i0,
+	std::size_t i1)
+{
+	const std::size_t n = i1-i0;
+	for(unsigned t=0;t<m_cpuThreads && n;++t)
+		threads.emplace_back([this,t,i0,n]
+		{
+			const std::size_t j0 = i0 + n*t/m_cpuThreads, j1 = i0 + n*(t+1)/m_cpuThreads;
+			Profiler::Span sp(profiler(),"CPU map");
+			m_cpuMap(m_input+j0,outputData()+j0,j1-j0);
+		});
+}
+
+template<class TestFixture>template<class Checker>unsigned BlockMapAFU<TestFixture>::checkRange(std::size_t i0,std::size_t i1,
+		Checker& checker,std::vector<std::size_t>& errIdx,bool printNow)
 {
 	unsigned errCt=0;
-	fixture.checker.clear();
-	cout << "Checking output" << endl;
+	const output_type* packedOutput = outputData();
 
-	for(unsigned i=0;i<m_packedInput.size();++i)
+	for(std::size_t i=i0;i<i1;++i)
 	{
-		Unpacker<typename TestFixture::input_container_type>  Ui(TestFixture::input_bits,m_packedInput[i]);
-		Unpacker<typename TestFixture::output_container_type> Uo(TestFixture::output_bits,m_packedOutput[i]);
+		Unpacker<input_type>  Ui(TestFixture::input_bits,m_input[i]);
+		Unpacker<output_type> Uo(TestFixture::output_bits,packedOutput[i]);
 
 		typename TestFixture::packed_input_type 	in;
 		typename TestFixture::packed_output_type 	out;
@@ -116,14 +545,115 @@ template<class TestFixture>bool BlockMapAFU<TestFixture>::check()
 		Ui & in;
 		Uo & out;
 
-		bool ok = fixture.checker.check(fixture.convertToNativeType(in),fixture.convertToNativeType(out));
+		bool ok = checker.check(fixture.convertToNativeType(in),fixture.convertToNativeType(out));
 		errCt += !ok;
 		if (!ok && errCt <= m_maxErrorsToPrint)
-			cout << "  (at sample " << i << ")" << endl;
+		{
+			if (printNow)
+				BLUELINK_TRACE(CheckMismatch,i);
+			else
+				errIdx.push_back(i);
+		}
+	}
+	return errCt;
+}
+
+template<class TestFixture>unsigned BlockMapAFU<TestFixture>::checkRangeExact(std::size_t i0,std::size_t i1,
+		std::vector<std::size_t>& errIdx)
+{
+	const output_type* packedOutput = outputData();
+	const output_type* expected = fixture.expectedOutput();
+
+	// compare the whole lines within [i0,i1) with SIMD, then resolve mismatching lines (and the ragged ends) per element
+	const std::size_t b0 = i0*sizeof(output_type), b1 = i1*sizeof(output_type);
+	const std::size_t l0 = (b0+CacheLineBytes-1)/CacheLineBytes, l1 = std::max(l0,b1/CacheLineBytes);
+
+	const char* o = reinterpret_cast<const char*>(packedOutput);
+	const char* e = reinterpret_cast<const char*>(expected);
+
+	unsigned errCt=0;
+	std::size_t next=i0;			// first element not yet compared
+
+	auto compareElements = [&](std::size_t j0,std::size_t j1)
+	{
+		for(std::size_t j=std::max(j0,next);j<j1;++j)
+			if (memcmp(packedOutput+j,expected+j,sizeof(output_type)))
+				if (++errCt <= m_maxErrorsToPrint)
+					errIdx.push_back(j);
+		next = std::max(next,j1);
+	};
+
+	compareElements(i0,std::min(i1,(l0*CacheLineBytes+sizeof(output_type)-1)/sizeof(output_type)));
+
+	for(std::size_t l=l0; (l=first_mismatched_line(o,e,l,l1)) < l1; ++l)
+		compareElements(l*CacheLineBytes/sizeof(output_type),
+				std::min(i1,((l+1)*CacheLineBytes+sizeof(output_type)-1)/sizeof(output_type)));
+
+	next = std::max(next,l1*CacheLineBytes/sizeof(output_type));
+	compareElements(next,i1);
+
+	return errCt;
+}
+
+template<class TestFixture>bool BlockMapAFU<TestFixture>::check(unsigned nThreads)
+{
+	const bool exact = has_bit_exact_output<TestFixture>::value;
+	nThreads = std::max(1U,std::min<unsigned>(nThreads,std::max(m_nInput,std::size_t(1))));
+
+	Profiler::Span sp(profiler(),"check");
+	unsigned errCt=0;
+	fixture.checker.clear();
+	BLUELINK_TRACE(CheckStart,m_nInput,exact);
+
+	typedef typename std::decay<decltype(fixture.checker)>::type checker_type;
+	if (!exact && nThreads > 1 && !has_checker_merge<checker_type>::value)
+	{
+		BLUELINK_TRACE(CheckSerial,nThreads);
+		nThreads = 1;
 	}
+
+	if (nThreads == 1 && !exact)
+	{
+		std::vector<std::size_t> dummy;
+		errCt = checkRange(0,m_nInput,fixture.checker,dummy,true);
+	}
+	else
+	{
+		// contiguous chunk per thread; first-N error reports are merged in chunk (ie. index) order so output is deterministic
+		std::vector<checker_type> 				checkers(nThreads,fixture.checker);
+		std::vector<std::vector<std::size_t>> 	errIdx(nThreads);
+		std::vector<unsigned> 					errCts(nThreads,0);
+		std::vector<std::thread>				threads;
+
+		for(unsigned t=0;t<nThreads;++t)
+			threads.emplace_back([&,t]
+			{
+				Profiler::Span sp(profiler(),"check chunk");
+				std::size_t i0 = m_nInput*t/nThreads, i1 = m_nInput*(t+1)/nThreads;
+				errCts[t] = checkChunk(i0,i1,checkers[t],errIdx[t],has_bit_exact_output<TestFixture>());
+			});
+
+		for(auto& th : threads)
+			th.join();
+
+		if (!exact)
+			mergeCheckers(checkers,has_checker_merge<checker_type>());
+
+		for(unsigned t=0;t<nThreads;++t)
+		{
+			for(std::size_t i : errIdx[t])
+				if (errCt++ < m_maxErrorsToPrint)
+					BLUELINK_TRACE(CheckMismatch,i);
+			errCt += errCts[t]-errIdx[t].size();
+		}
+	}
+
 	if (errCt > m_maxErrorsToPrint)
-		cout << " ... and " << errCt-m_maxErrorsToPrint << " more errors truncated" << endl;
+		BLUELINK_TRACE(CheckTruncated,errCt-m_maxErrorsToPrint);
 
-	cout << "  Errors: " << errCt << '/' << m_packedInput.size() << endl;
+	if (errCt == 0)
+		BLUELINK_TRACE(CheckPassed,m_nInput);
+	else
+		BLUELINK_TRACE(CheckFailed,errCt,m_nInput);
 	return errCt==0;
 }
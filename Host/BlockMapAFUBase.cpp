@@ -6,13 +6,212 @@
  */
 
 #include "BlockMapAFUBase.hpp"
+#include "AFUBackend.hpp"
+#include "BlockMapAFULayout.hpp"
 
 #include <boost/align/is_aligned.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+#include <glob.h>
 
 using namespace std;
 
+// the hand-written WED must match BSV BlockMapWED (layout generated from DedicatedAFU/BlockMapAFU.bsv)
+typedef BSVLayout::BlockMapAFU::BlockMapWED BSVBlockMapWED;
+
+static_assert(sizeof(BlockMapWED)*8 == BSVBlockMapWED::bits,"BlockMapWED size differs from BSV");
+static_assert(offsetof(BlockMapWED,param) == 0,"BlockMapWED::param must start the WED");
+static_assert(offsetof(BlockMapParam,dst)*8 == BSVBlockMapWED::block_addrTo::offset &&
+		offsetof(BlockMapParam,oSize)*8 == BSVBlockMapWED::block_oSize::offset &&
+		offsetof(BlockMapParam,src)*8 == BSVBlockMapWED::block_addrFrom::offset &&
+		offsetof(BlockMapParam,iSize)*8 == BSVBlockMapWED::block_iSize::offset,"BlockMapParam field offsets differ from BSV");
+static_assert(BSVBlockMapWED::block_addrTo::littleEndian && BSVBlockMapWED::block_oSize::littleEndian &&
+		BSVBlockMapWED::block_addrFrom::littleEndian && BSVBlockMapWED::block_iSize::littleEndian,
+		"BlockMapWED fields must be LittleEndian# to be host-native");
+
+namespace {
+
+// Splits a comma-separated device list; a piece that doesn't start a device (eg. emulator args) stays with the previous one
+vector<string> splitDevices(const char* devStr)
+{
+	vector<string> pieces, d;
+	boost::split(pieces,devStr,boost::is_any_of(","));
+
+	for(const string& p : pieces)
+		if (d.empty() || p.compare(0,1,"/") == 0 || p.compare(0,strlen(AFUBackend::prefix),AFUBackend::prefix) == 0)
+			d.push_back(p);
+		else
+			d.back() += ","+p;
+	return d;
+}
+
+uint64_t gcd(uint64_t a,uint64_t b)
+{
+	while(b)
+	{
+		uint64_t t = a%b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Per-device throughput estimates (bytes/s), shared by all BlockMapAFUBase instances so they persist across jobs
+mutex 					throughputMutex;
+map<string,double> 		throughputEstimate;
+
+}
+
+BlockMapAFUBase::BlockMapAFUBase(const char* devStr) :
+	AFU(splitDevices(devStr).front()),
+	m_devices(splitDevices(devStr))
+{
+}
+
+string BlockMapAFUBase::allDevices()
+{
+	vector<string> d;
+	glob_t g;
+
+	if (glob("/dev/cxl/afu*.0d",0,nullptr,&g) == 0)
+		for(size_t i=0;i<g.gl_pathc;++i)
+			d.push_back(g.gl_pathv[i]);
+	globfree(&g);
+
+	return boost::algorithm::join(d,",");
+}
+
+double BlockMapAFUBase::measuredThroughput(const std::string& dev)
+{
+	lock_guard<mutex> L(throughputMutex);
+	auto it = throughputEstimate.find(dev);
+	return it == throughputEstimate.end() ? 0.0 : it->second;
+}
+
+void BlockMapAFUBase::planShards()
+{
+	m_shards.clear();
+	m_shardBytes.assign(m_devices.size(),0);
+
+	const BlockMapParam job = m_wed->param;
+
+	// Unit = the smallest piece with whole cache lines of both input and output in the job's ratio
+	const uint64_t g = gcd(job.iSize/128,job.oSize/128);
+	if (m_devices.size() < 2 || g == 0)
+	{
+		m_shardBytes[0] = job.iSize+job.oSize;
+		return;
+	}
+
+	const uint64_t iUnit = job.iSize/g, oUnit = job.oSize/g;
+
+	// weight by measured throughput; unmeasured cards get the mean of the measured ones (or 1 if none measured)
+	vector<double> w(m_devices.size(),0.0);
+	{
+		lock_guard<mutex> L(throughputMutex);
+		for(size_t i=0;i<m_devices.size();++i)
+		{
+			auto it = throughputEstimate.find(m_devices[i]);
+			w[i] = it == throughputEstimate.end() ? 0.0 : it->second;
+		}
+	}
+	const size_t nMeasured = count_if(w.begin(),w.end(),[](double x){ return x > 0.0; });
+	const double fill = nMeasured ? accumulate(w.begin(),w.end(),0.0)/nMeasured : 1.0;
+	for(double& x : w)
+		if (x <= 0.0)
+			x = fill;
+
+	const double wSum = accumulate(w.begin(),w.end(),0.0);
+
+	vector<uint64_t> units(m_devices.size());
+	uint64_t assigned=0;
+	for(size_t i=0;i<units.size();++i)
+		assigned += (units[i] = uint64_t(double(g)*w[i]/wSum));
+	units[max_element(w.begin(),w.end())-w.begin()] += g-assigned;			// rounding remainder to the fastest card
+
+	// this device takes the first shard; the rest get their own AFU handles and WEDs
+	uint64_t off=0;
+	for(size_t i=0;i<m_devices.size();++i)
+	{
+		BlockMapParam p;
+		p.src   = static_cast<const char*>(job.src) + off*iUnit;
+		p.iSize = units[i]*iUnit;
+		p.dst   = static_cast<char*>(job.dst) + off*oUnit;
+		p.oSize = units[i]*oUnit;
+		off += units[i];
+
+		m_shardBytes[i] = p.iSize+p.oSize;
+
+		if (i == 0)
+			m_wed->param = p;
+		else
+		{
+			m_shards.emplace_back(new BlockMapAFUBase(m_devices[i].c_str()));
+			m_shards.back()->m_wed->param = p;
+			m_shards.back()->m_wait = m_wait;
+			m_shards.back()->m_verbose = m_verbose;
+			m_shards.back()->m_runTimeout = m_runTimeout;
+			m_shards.back()->m_tuning = m_tuning;
+			m_shards.back()->start();
+		}
+
+		if (m_verbose)
+			cout << dec << "Shard " << i << " on " << m_devices[i] << ": " << units[i] << '/' << g << " units (weight " << w[i]/wSum << ")" << endl;
+	}
+}
+
+void BlockMapAFUBase::runShards()
+{
+	const size_t N = m_devices.size();
+	vector<bool> done(N,false);
+	vector<chrono::steady_clock::duration> t(N);
+
+	const auto t0 = chrono::steady_clock::now();
+
+	AFU::mmio_write64_fast(0,Start);
+	for(const auto& s : m_shards)
+		s->mmio_write64_fast(0,Start);
+
+	// poll all cards, noting when each finishes
+	auto allDone = [&]
+	{
+		bool all=true;
+		for(size_t i=0;i<N;++i)
+		{
+			if (!done[i] && (done[i] = (i == 0 ? status() : m_shards[i-1]->status()) == Done))
+				t[i] = chrono::steady_clock::now()-t0;
+			all &= done[i];
+		}
+		return all;
+	};
+
+	if (!m_wait.until(allDone,m_runTimeout))
+		BLUELINK_TRACE(ShardTimeout);
+
+	// exponentially-weighted update of per-card throughput from this job (only shards big enough to time meaningfully)
+	lock_guard<mutex> L(throughputMutex);
+	for(size_t i=0;i<N;++i)
+		if (done[i] && m_shardBytes[i] >= 1<<20)
+		{
+			const double bw = double(m_shardBytes[i])/chrono::duration<double>(t[i]).count();
+			double& est = throughputEstimate[m_devices[i]];
+			est = est > 0.0 ? 0.5*est + 0.5*bw : bw;
+
+			if (m_verbose)
+				cout << "  " << m_devices[i] << ": " << bw*1e-9 << " GB/s (estimate now " << est*1e-9 << " GB/s)" << endl;
+		}
+}
+
 void BlockMapAFUBase::start()
 {
 	if(!boost::alignment::is_aligned(128,m_wed.get()))
@@ -26,15 +225,23 @@ void BlockMapAFUBase::start()
 	if(m_wed->param.oSize % 128 != 0)
 		throw std::logic_error("Unaligned write transfer size");
 
-	AFU::start(m_wed.get());
+	planShards();
+
+	{
+		Profiler::Span s(m_profiler,"attach");
+		AFU::start(m_wed.get());
 
-	Status st=Resetting;
+		WaitPolicy w(m_wait);				// copy so setup waits don't pollute the completion stats
+		if (!w.until([this]{ return status() == Waiting; },m_startTimeout))
+			BLUELINK_TRACE(StartTimeout,status());
+	}
 
-	unsigned N;
-	for(N=0;N<100 && (st=status()) != Waiting;++N)
+	AFU::mmio_write64_fast(0x80,m_tuning.pack());		// applied when the streams start
+
+	if (m_profiler)
 	{
-		cout << "  Waiting for 'waiting' status (st=" << st << " looking for " << Waiting << ")" << endl;
-		usleep(m_usecDelayTime);
+		m_profiler->clock().reset();
+		m_profiler->clock().sample(*this,0x48);
 	}
 
 	if (m_verbose)
@@ -44,41 +251,207 @@ void BlockMapAFUBase::start()
 
 void BlockMapAFUBase::awaitReady()
 {
-	unsigned i;
-	for(i=0;i<m_waitTimeoutSteps && (mmio_read64(0)&0xff) != Waiting;++i)
-	{
-		usleep(m_waitSleep);
-	}
-	if (i == m_waitTimeoutSteps)
-		cout << "ERROR: Timeout while waiting for Waiting status" << endl;
+	WaitPolicy w(m_wait);
+	if (!w.until([this]{ return status() == Waiting; },m_readyTimeout))
+		BLUELINK_TRACE(ReadyTimeout,status());
 }
 
 void BlockMapAFUBase::run()
 {
-	cout << "Starting" << endl;
-	AFU::mmio_write64(0,0x0ULL);		// start signal: write 0 to MMIO 0
+	BLUELINK_TRACE(Run);
+
+	Profiler::Span s(m_profiler,"run");
+
+	if (!m_shards.empty())
+	{
+		runShards();
+		recordTimestamps();
+		return;
+	}
+
+	AFU::mmio_write64_fast(0,Start);		// start signal: write 0 to MMIO 0
 
-	unsigned N;
-	Status st=Resetting;
+	const bool ok = m_wait.until([this]{ return status() == Done; },m_runTimeout,this,IrqJobDone,IrqJobError);
 
-	for(N=0;N < m_timeoutDelay && (st=Status(AFU::mmio_read64(0)&0xff)) != Done;++N)	// wait for done status
+	if (!ok && m_wait.failed())
 	{
-		cout << "  status " << hex << st << " input: " << dec << AFU::mmio_read64(0x38) << "/" << AFU::mmio_read64(0x30) << "  output: " << AFU::mmio_read64(0x28) << "/" << AFU::mmio_read64(0x20) << endl << flush;
-		usleep(m_usecDelayTime);
+		BLUELINK_TRACE(JobError);		// the AFU has stopped, so its registers can't be read
+		return;
 	}
+	recordTimestamps();
 
-	if (N == m_timeoutDelay)
-		cout << "ERROR: Timeout waiting for done status" << endl;
+	if (!ok || m_verbose)
+	{
+		uint64_t regs[4];					// snapshot of MMIO 0x20-0x38: output size, output transferred, input size, input transferred
+		AFU::mmio_read_block(0x20,4,regs);
+		if (!ok)
+			BLUELINK_TRACE(RunTimeout,status(),regs[3],regs[2],regs[1],regs[0]);
+		else
+			cout << "status " << hex << status() << " input: " << dec << regs[3] << "/" << regs[2] << "  output: " << regs[1] <<
+				"/" << regs[0] << endl;
+	}
+}
+
+void BlockMapAFUBase::recordTimestamps()
+{
+	if (!m_profiler)
+		return;
+
+	m_profiler->clock().sample(*this,0x48);
+
+	// WED read, map start, input done, output done, map done (0 = hasn't happened; an AFU without timestamps reads deadbeef)
+	uint64_t ts[5];
+	AFU::mmio_read_block(0x50,5,ts);
+	auto valid = [](uint64_t t){ return t != 0 && t != 0xdeadbeefbaadc0deULL; };
+
+	if (valid(ts[0]))
+		m_profiler->afuEvent("status","WED read",ts[0]);
+	if (valid(ts[0]) && valid(ts[1]))
+		m_profiler->afuSpan("status","Waiting",ts[0],ts[1]);
+	if (valid(ts[1]) && valid(ts[4]))
+		m_profiler->afuSpan("status","Running",ts[1],ts[4]);
+	if (valid(ts[1]) && valid(ts[2]))
+		m_profiler->afuSpan("read stream","input",ts[1],ts[2]);
+	if (valid(ts[1]) && valid(ts[3]))
+		m_profiler->afuSpan("write stream","output",ts[1],ts[3]);
+	if (valid(ts[4]))
+		m_profiler->afuEvent("status","Done",ts[4]);
 }
 
 void BlockMapAFUBase::terminate()
 {
-	cout << "Terminating" << endl;
-	AFU::mmio_write64(0,0x1ULL);
+	BLUELINK_TRACE(Terminate);
+
+	for(const auto& s : m_shards)
+		s->terminate();
+	m_shards.clear();
+
+	AFU::mmio_write64_fast(0,Terminate);
+}
+
+
+void BlockMapAFUBase::detach()
+{
+	m_shards.clear();					// each shard detaches as it's destroyed
+	AFU::close();
 }
 
+void BlockMapAFUBase::reset()
+{
+	m_shards.clear();					// each shard detaches as it's destroyed
+	AFU::reopen();
+}
 
 BlockMapAFUBase::Status BlockMapAFUBase::status() const
 {
-	return BlockMapAFUBase::Status(mmio_read64(0) & 0xff);
+	const uint8_t st = mmio_read64_fast(0) & 0xff;
+	if (st != m_lastStatus.load(memory_order_relaxed))
+		BLUELINK_TRACE(Status,m_lastStatus.exchange(st,memory_order_relaxed),st);
+	return BlockMapAFUBase::Status(st);
+}
+
+void BlockMapAFUBase::queueChunk(const void* src,uint64_t iSize,void* dst,uint64_t oSize,bool last)
+{
+	if(!boost::alignment::is_aligned(128,src) || !boost::alignment::is_aligned(128,dst))
+		throw std::logic_error("Unaligned chunk address");
+	if(iSize % 128 != 0 || oSize % 128 != 0)
+		throw std::logic_error("Unaligned chunk size");
+
+	mmio_write64_fast(0x08,reinterpret_cast<uint64_t>(dst));
+	mmio_write64_fast(0x10,reinterpret_cast<uint64_t>(src));
+	mmio_write64_fast(0x20,oSize);
+	mmio_write64_fast(0x30,iSize);
+	mmio_write64_fast(0x00,last ? QueueLastChunk : QueueChunk);
+}
+
+void BlockMapAFUBase::queueFill(void* dst,uint64_t size)
+{
+	if(!boost::alignment::is_aligned(128,dst) || size % 128 != 0)
+		throw std::logic_error("Unaligned fill");
+
+	mmio_write64_fast(0x08,reinterpret_cast<uint64_t>(dst));
+	mmio_write64_fast(0x20,size);
+	mmio_write64_fast(0x00,QueueFill);
+}
+
+void BlockMapAFUBase::queueFill(void* dst,uint64_t size,uint64_t pattern)
+{
+	if(!boost::alignment::is_aligned(128,dst) || size % 128 != 0)
+		throw std::logic_error("Unaligned fill");
+
+	mmio_write64_fast(0x40,pattern);
+	mmio_write64_fast(0x08,reinterpret_cast<uint64_t>(dst));
+	mmio_write64_fast(0x20,size);
+	mmio_write64_fast(0x00,QueueFillPattern);
+}
+
+unsigned BlockMapAFUBase::fillsDone() const
+{
+	return mmio_read64_fast(0x40);
+}
+
+bool BlockMapAFUBase::awaitFills(unsigned n)
+{
+	return awaitFills(n,m_runTimeout);
+}
+
+bool BlockMapAFUBase::awaitFills(unsigned n,std::chrono::milliseconds timeout)
+{
+	if (!m_wait.until([this,n]{ return fillsDone() >= n; },timeout))
+	{
+		BLUELINK_TRACE(FillTimeout,n-1);
+		return false;
+	}
+	return true;
+}
+
+uint64_t BlockMapAFUBase::inputTransferred() const
+{
+	return mmio_read64_fast(0x38);
+}
+
+uint64_t BlockMapAFUBase::outputTransferred() const
+{
+	return mmio_read64_fast(0x28);
+}
+
+uint64_t BlockMapAFUBase::commandReplays() const
+{
+	return mmio_read64_fast(0x78);
+}
+
+uint64_t BlockMapAFUBase::StreamTuning::pack() const
+{
+	auto b = [](unsigned v){ return uint64_t(v > 255 ? 0 : v); };
+	return b(readTags) | b(readBuffers) << 8 | b(writeTags) << 16 | b(writeBuffers) << 24;
+}
+
+BlockMapAFUBase::StreamTuning BlockMapAFUBase::StreamTuning::unpack(const uint64_t x)
+{
+	return StreamTuning(x & 0xff,(x >> 8) & 0xff,(x >> 16) & 0xff,(x >> 24) & 0xff);
+}
+
+BlockMapAFUBase::StreamTuning BlockMapAFUBase::activeStreamTuning() const
+{
+	return StreamTuning::unpack(mmio_read64_fast(0x80));
+}
+
+BlockMapAFUBase::StreamTuning BlockMapAFUBase::streamTuningMax() const
+{
+	return StreamTuning::unpack(mmio_read64_fast(0x88));
+}
+
+unsigned BlockMapAFUBase::outputChunksDone() const
+{
+	return mmio_read64_fast(0x18);
+}
+
+bool BlockMapAFUBase::awaitOutputChunks(unsigned n)
+{
+	if (!m_wait.until([this,n]{ return outputChunksDone() >= n; },m_runTimeout))
+	{
+		BLUELINK_TRACE(ChunkTimeout,n-1,inputTransferred(),outputTransferred());
+		return false;
+	}
+	return true;
 }
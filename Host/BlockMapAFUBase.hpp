@@ -10,6 +10,14 @@
 
 #include <BlueLink/Host/AFU.hpp>
 #include <BlueLink/Host/WED.hpp>
+#include <BlueLink/Host/WaitPolicy.hpp>
+#include <BlueLink/Host/Profiler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
 
 struct BlockMapParam {
 	void*		dst;
@@ -24,11 +32,25 @@ struct BlockMapWED
 	uint64_t		pad[12];
 };
 
+/** Host control of a mkBlockMapAFU.
+ *
+ * Multi-card sharding: if devStr is a comma-separated list of devices (eg. "/dev/cxl/afu0.0d,/dev/cxl/afu1.0d", see
+ * allDevices()), start/run/terminate split the job across all of them. The job is cut into shards whose input and output
+ * sizes are both whole cache lines in the job's output:input ratio, sized in proportion to each card's measured throughput
+ * (remembered per device across jobs), and each card reads/writes its part of the caller's buffers in place. status() and
+ * chunked mode apply to the first device only.
+ */
+
 class BlockMapAFUBase : public AFU
 {
 public:
-	BlockMapAFUBase(const char* devStr) : AFU(devStr){}
+	BlockMapAFUBase(const char* devStr);
 	enum Status { Resetting=0, Ready=1, Waiting=2, Running=3, Done=4 };
+	enum Interrupt { IrqJobDone=1, IrqJobError=2 };		// interrupt sources raised by mkBlockMapAFU/mkDedicatedAFU
+	enum Command { Start=0, Terminate=1, QueueChunk=2, QueueLastChunk=3, QueueFill=4, QueueFillPattern=5 };	// values written to MMIO 0x00
+
+	static constexpr unsigned ChunkQueueDepth=2;		// chunks the AFU can hold queued beyond the one in progress
+	static constexpr unsigned FillQueueDepth=2;			// fills the AFU can hold queued beyond the one in progress
 
 	void start();						// starts the AFU, reads WED, and waits for run()
 
@@ -36,22 +58,104 @@ public:
 
 	void run();							// starts the block map
 	void terminate();					// send termination pulse to AFU (allow to finish, kills MMIO)
+	void reset();						///< Detach from every card and reopen it, stopping a job that won't finish
+
+	Status status() const;				// traces a Status event when it differs from the last one read
+
+	// Chunked mode (see mkBlockMapAFU): queue chunks after start() instead of calling run()
+	void queueChunk(const void* src,uint64_t iSize,void* dst,uint64_t oSize,bool last);
+
+	uint64_t inputTransferred() const;		///< Input bytes consumed, cumulative over chunks (MMIO 0x38)
+	uint64_t outputTransferred() const;		///< Output bytes produced, cumulative over chunks (MMIO 0x28), may not be in memory yet
+	unsigned outputChunksDone() const;		///< Chunks whose output has been fully written to host memory (MMIO 0x18)
+
+	bool awaitOutputChunks(unsigned n);		///< Wait until at least n chunks' output is complete; false on timeout
+
+	uint64_t commandReplays() const;		///< Commands reissued after page faults or other recoverable responses (MMIO 0x78)
+
+	/// Limits on each stream's parallel tags and buffer depth within the synthesized maxima (0 = maximum), see mkBlockMapAFU
+	struct StreamTuning
+	{
+		StreamTuning(unsigned rt=0,unsigned rb=0,unsigned wt=0,unsigned wb=0) :
+			readTags(rt),readBuffers(rb),writeTags(wt),writeBuffers(wb){}
+
+		unsigned	readTags;
+		unsigned	readBuffers;
+		unsigned	writeTags;
+		unsigned	writeBuffers;
+
+		uint64_t			pack() const;				///< MMIO 0x80/0x88 layout (values over 255 become 0)
+		static StreamTuning	unpack(uint64_t x);
+
+		/// What start() writes unless told otherwise: 4 read tags (the read stream's size before it was made tunable), rest at maximum
+		static StreamTuning	defaults(){ return StreamTuning(4); }
+	};
 
-	Status status() const;
+	void			streamTuning(const StreamTuning& t){ m_tuning=t; }	///< Written to every card by start(), so set it before
+	StreamTuning	streamTuning() const { return m_tuning; }
+	StreamTuning	activeStreamTuning() const;		///< Limits in effect on this card once its streams have started (MMIO 0x80)
+	StreamTuning	streamTuningMax() const;		///< Synthesized maxima (MMIO 0x88)
+
+	// Fill mode (see mkBlockMapAFU): after start(), clear (zero_m) or pattern-fill line-aligned host ranges independently of the map
+	void queueFill(void* dst,uint64_t size);					///< Zero size bytes at dst
+	void queueFill(void* dst,uint64_t size,uint64_t pattern);	///< Write pattern (host byte order) to every 8 bytes
+	unsigned fillsDone() const;				///< Fills completed (MMIO 0x40)
+	bool awaitFills(unsigned n);			///< Wait until at least n fills are complete; false on timeout
+	bool awaitFills(unsigned n,std::chrono::milliseconds timeout);
+
+	void useInterrupts(bool en){ m_wait.mode(en ? WaitPolicy::Event : WaitPolicy::Backoff); }	// run() blocks on completion interrupt
+
+	/// Policy used for all waits on the AFU; its stats hold the completion latency of run() and awaitOutputChunks()
+	WaitPolicy& 		waitPolicy() 		{ return m_wait; }
+	const WaitPolicy& 	waitPolicy() const 	{ return m_wait; }
+
+	/** Record attach and run spans, and after run() the AFU's event timestamps (MMIO 0x50-0x70), in a profiler (null to stop).
+	 * start() re-syncs the profiler's AFU clock and run() refines it on completion, so the clock follows this AFU.
+	 */
+	void		profiler(Profiler* p){ m_profiler=p; }
+	Profiler*	profiler() const { return m_profiler; }
+
+	/// Record the AFU's event timestamps in the profiler, eg. after the last chunk in chunked mode (run() does this itself)
+	void recordTimestamps();
+
+	void verbose(bool v){ m_verbose=v; }					// print status/register details while starting & running
+	void runTimeout(std::chrono::milliseconds t){ m_runTimeout=t; }
+	std::chrono::milliseconds runTimeout() const { return m_runTimeout; }
+
+	/// All cxl dedicated-mode AFU devices present, as a comma-separated list usable as a devStr
+	static std::string allDevices();
+
+	/// Measured throughput (input+output bytes/s) for a device, or 0 if it hasn't completed a sharded job yet
+	static double measuredThroughput(const std::string& dev);
 
 protected:
+	void detach();						///< Detach from every card; derived classes call this before freeing buffers it may be writing
+
 	StackWED<BlockMapWED,128,128> m_wed;
 
 private:
 
-	unsigned m_usecDelayTime=1000;
-	unsigned m_timeoutDelay=2000;
+	std::chrono::milliseconds m_startTimeout{100};			// attach to Waiting status
+	std::chrono::milliseconds m_readyTimeout{1000};			// awaitReady
+	std::chrono::milliseconds m_runTimeout{2000};			// start signal to Done (or per chunk)
+
+	WaitPolicy m_wait;
+
+	bool m_verbose=false;
+
+	Profiler* m_profiler=nullptr;
+
+	StreamTuning m_tuning=StreamTuning::defaults();
 
-	unsigned m_waitTimeoutSteps=10;
-	unsigned m_waitSleep=100000;
+	mutable std::atomic<uint8_t> m_lastStatus{Resetting};		// for tracing transitions (racy updates only duplicate an event)
 
+	// Sharding across additional cards
+	void planShards();
+	void runShards();
 
-	bool m_verbose=true;
+	std::vector<std::string> 						m_devices;			// all devices, [0] is this one
+	std::vector<std::unique_ptr<BlockMapAFUBase>> 	m_shards;			// AFUs for m_devices[1..] (empty if not sharded)
+	std::vector<uint64_t>							m_shardBytes;		// input+output bytes assigned to each device
 };
 
 
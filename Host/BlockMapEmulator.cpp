@@ -0,0 +1,398 @@
+/*
+ * BlockMapEmulator.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "BlockMapEmulator.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+BlockMapEmulator::BlockMapEmulator(const std::string& args)
+{
+	istringstream is(args);
+	string kv;
+
+	while(getline(is,kv,','))
+	{
+		const size_t eq = kv.find('=');
+		if (eq == string::npos)
+		{
+			cerr << "BlockMapEmulator: ignoring malformed argument '" << kv << "'" << endl;
+			continue;
+		}
+		const string k = kv.substr(0,eq);
+		const double v = strtod(kv.c_str()+eq+1,nullptr);
+
+		if (k == "rbw")
+			m_cfg.readBandwidth = v;
+		else if (k == "wbw")
+			m_cfg.writeBandwidth = v;
+		else if (k == "lat")
+			m_cfg.chunkLatency = chrono::nanoseconds(uint64_t(v));
+		else if (k == "mmio")
+			m_cfg.mmioLatency = chrono::nanoseconds(uint64_t(v));
+		else if (k == "burst")
+			m_cfg.burstBytes = max(size_t(v),size_t(128));
+		else if (k == "zbw")
+			m_cfg.zeroBandwidth = v;
+		else if (k == "clk")
+			m_cfg.clockHz = v;
+		else if (k == "mlat")
+			m_cfg.memoryLatency = chrono::nanoseconds(uint64_t(v));
+		else
+			cerr << "BlockMapEmulator: ignoring unknown argument '" << k << "'" << endl;
+	}
+}
+
+BlockMapEmulator::BlockMapEmulator(const Config& cfg) :
+	m_cfg(cfg)
+{
+	m_cfg.burstBytes = max(m_cfg.burstBytes,size_t(128));
+}
+
+BlockMapEmulator::~BlockMapEmulator()
+{
+	// detaching resets the AFU: stop at the next burst rather than finishing queued work
+	m_detached = true;
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_terminate=true;
+	}
+	m_cv.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+	if (m_fillThread.joinable())
+		m_fillThread.join();
+}
+
+string BlockMapEmulator::description() const
+{
+	ostringstream os;
+	os << "BlockMap emulator (read " << m_cfg.readBandwidth*1e-9 << " GB/s, write " << m_cfg.writeBandwidth*1e-9 << " GB/s, " <<
+		m_cfg.chunkLatency.count() << " ns chunk latency, " << m_cfg.mmioLatency.count() << " ns MMIO latency)";
+	return os.str();
+}
+
+void BlockMapEmulator::copyMap(const uint8_t* in,const std::size_t iBytes,uint8_t* out,const std::size_t oBytes)
+{
+	memcpy(out,in,min(iBytes,oBytes));
+	if (oBytes > iBytes)
+		memset(out+iBytes,0,oBytes-iBytes);
+}
+
+void BlockMapEmulator::attach(void* wed)
+{
+	if (m_thread.joinable())
+		throw std::logic_error("BlockMapEmulator already attached");
+
+	memcpy(&m_wed,wed,sizeof(m_wed));
+	m_tsWED = cycles();
+	m_status = BlockMapAFUBase::Waiting;
+	m_thread = thread(&BlockMapEmulator::worker,this);
+	m_fillThread = thread(&BlockMapEmulator::fillWorker,this);
+}
+
+void MemcopyEmulator::attach(void* wed)
+{
+	uint64_t w[3];						// source address, destination address, size
+	memcpy(w,wed,sizeof(w));
+
+	BlockMapWED bw;
+	memset(&bw,0,sizeof(bw));
+	bw.param.dst = reinterpret_cast<void*>(w[1]);
+	bw.param.oSize = w[2];
+	bw.param.src = reinterpret_cast<const void*>(w[0]);
+	bw.param.iSize = w[2];
+
+	BlockMapEmulator::attach(&bw);
+}
+
+string MemcopyEmulator::description() const
+{
+	string s = BlockMapEmulator::description();
+	return "Memcopy" + s.substr(s.find(' '));
+}
+
+void BlockMapEmulator::mmioDelay() const
+{
+	if (m_cfg.mmioLatency.count())
+	{
+		const auto until = chrono::steady_clock::now()+m_cfg.mmioLatency;
+		while(chrono::steady_clock::now() < until){}
+	}
+}
+
+uint64_t BlockMapEmulator::cycles() const
+{
+	return uint64_t(chrono::duration<double>(chrono::steady_clock::now()-m_reset).count()*m_cfg.clockHz);
+}
+
+uint64_t BlockMapEmulator::mmio_read64(const unsigned offset)
+{
+	mmioDelay();
+
+	switch(offset)
+	{
+	case 0x00:
+	{
+		const unsigned st = m_status;
+		const uint64_t idle = st == BlockMapAFUBase::Done ? 3 : 0;		// stream done bits [49:48]
+		return (idle << 48) | st;
+	}
+	case 0x08: return reinterpret_cast<uint64_t>(m_wed.param.dst);
+	case 0x10: return reinterpret_cast<uint64_t>(m_wed.param.src);
+	case 0x18: return m_oChunksDone;
+	case 0x20: return m_wed.param.oSize;
+	case 0x28: return m_oBytes;
+	case 0x30: return m_wed.param.iSize;
+	case 0x38: return m_iBytes;
+	case 0x40: return m_fillsDone;
+	case 0x48: return cycles();
+	case 0x50: return m_tsWED;
+	case 0x58: return m_tsStart;
+	case 0x60: return m_tsIDone;
+	case 0x68: return m_tsODone;
+	case 0x70: return m_tsDone;
+	case 0x78: return 0;									// no faults to replay
+	case 0x80: return m_tuning;
+	case 0x88: return m_cfg.streamMax.pack();
+	default:   return 0xdeadbeefbaadc0deULL;
+	}
+}
+
+void BlockMapEmulator::mmio_write64(const unsigned offset,const uint64_t data)
+{
+	mmioDelay();
+
+	switch(offset)
+	{
+	case 0x00:
+		switch(data)
+		{
+		case BlockMapAFUBase::Start:
+			queueChunk(Chunk{
+				static_cast<const uint8_t*>(m_wed.param.src),m_wed.param.iSize,
+				static_cast<uint8_t*>(m_wed.param.dst),m_wed.param.oSize,
+				true});
+			break;
+		case BlockMapAFUBase::Terminate:
+			{
+				lock_guard<mutex> L(m_mutex);
+				m_terminate=true;
+			}
+			m_cv.notify_all();
+			break;
+		case BlockMapAFUBase::QueueChunk:
+		case BlockMapAFUBase::QueueLastChunk:
+			m_stage.last = data == BlockMapAFUBase::QueueLastChunk;
+			queueChunk(m_stage);
+			break;
+		case BlockMapAFUBase::QueueFill:
+		case BlockMapAFUBase::QueueFillPattern:
+			queueFill(Fill{ m_stage.dst, m_stage.oSize, data == BlockMapAFUBase::QueueFill, m_stagePattern });
+			break;
+		}
+		break;
+	case 0x08: m_stage.dst = reinterpret_cast<uint8_t*>(data); break;
+	case 0x10: m_stage.src = reinterpret_cast<const uint8_t*>(data); break;
+	case 0x20: m_stage.oSize = data; break;
+	case 0x30: m_stage.iSize = data; break;
+	case 0x40: m_stagePattern = data; break;
+	case 0x80: m_tuneReq = data; break;
+	default:
+		break;
+	}
+}
+
+void BlockMapEmulator::queueChunk(const Chunk& c)
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		// hardware starts a chunk within a few cycles of it being queued, so count the one in progress as free queue space
+		if (m_chunks.size() + m_busy > chunkQueueDepth)
+		{
+			BLUELINK_TRACE(EmuChunkOverflow);
+			return;
+		}
+		m_chunks.push_back(c);
+	}
+	m_cv.notify_all();
+}
+
+void BlockMapEmulator::queueFill(const Fill& f)
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		if (m_fills.size() + m_fillBusy > fillQueueDepth)
+		{
+			BLUELINK_TRACE(EmuFillOverflow);
+			return;
+		}
+		m_fills.push_back(f);
+	}
+	m_cv.notify_all();
+}
+
+AFU::Event BlockMapEmulator::await_event(const unsigned timeout_ms)
+{
+	unique_lock<mutex> L(m_mutex);
+
+	AFU::Event ev;
+	if (m_cv.wait_for(L,chrono::milliseconds(timeout_ms),[this]{ return !m_events.empty(); }))
+	{
+		ev = m_events.front();
+		m_events.pop_front();
+	}
+	return ev;
+}
+
+void BlockMapEmulator::worker()
+{
+	for(bool last=false; !last;)
+	{
+		Chunk c;
+		{
+			unique_lock<mutex> L(m_mutex);
+			m_cv.wait(L,[this]{ return m_terminate || !m_chunks.empty(); });
+			if (m_chunks.empty() || m_detached)
+				return;
+			c = m_chunks.front();
+			m_chunks.pop_front();
+			m_busy = true;
+		}
+
+		if (m_status != BlockMapAFUBase::Running)
+		{
+			m_tsStart = cycles();
+			m_status = BlockMapAFUBase::Running;
+		}
+		runChunk(c);
+
+		{
+			lock_guard<mutex> L(m_mutex);
+			++m_oChunksDone;
+			m_busy = false;
+		}
+		last = c.last;
+	}
+
+	m_tsIDone = m_tsODone = cycles();			// streams run in lockstep here
+	m_tsDone = cycles();
+	m_status = BlockMapAFUBase::Done;
+
+	{
+		lock_guard<mutex> L(m_mutex);
+		AFU::Event ev;
+		ev.type = AFU::Event::Interrupt;
+		ev.irq = BlockMapAFUBase::IrqJobDone;
+		m_events.push_back(ev);
+	}
+	m_cv.notify_all();
+}
+
+void BlockMapEmulator::runChunk(const Chunk& c)
+{
+	const MapFunction& f = m_cfg.map ? m_cfg.map : MapFunction(copyMap);
+
+	// streams latch their tuning when they start, clamped to the synthesized maxima (0 = maximum)
+	const BlockMapAFUBase::StreamTuning req = BlockMapAFUBase::StreamTuning::unpack(m_tuneReq);
+	auto clamp = [](unsigned v,unsigned vMax){ return v == 0 || v > vMax ? vMax : v; };
+	const BlockMapAFUBase::StreamTuning tn(
+		clamp(req.readTags,m_cfg.streamMax.readTags),clamp(req.readBuffers,m_cfg.streamMax.readBuffers),
+		clamp(req.writeTags,m_cfg.streamMax.writeTags),clamp(req.writeBuffers,m_cfg.streamMax.writeBuffers));
+	m_tuning = tn.pack();
+
+	const double rbw = streamBandwidth(m_cfg.readBandwidth,tn.readTags,tn.readBuffers);
+	const double wbw = streamBandwidth(m_cfg.writeBandwidth,tn.writeTags,tn.writeBuffers);
+
+	auto t = chrono::steady_clock::now() + m_cfg.chunkLatency;
+	this_thread::sleep_until(t);
+
+	// each burst takes as long as the slower of its read and write at the configured bandwidths (streams run concurrently)
+	const size_t nBursts = max(size_t(1),(c.iSize+m_cfg.burstBytes-1)/m_cfg.burstBytes);
+
+	size_t iDone=0, oDone=0;
+	for(size_t b=0;b<nBursts && !m_detached;++b)
+	{
+		const size_t iNext = min(c.iSize,(b+1)*m_cfg.burstBytes);
+		const size_t oNext = b+1 == nBursts ? c.oSize : min(c.oSize,(c.oSize*iNext/max(c.iSize,size_t(1)))&~size_t(127));
+
+		f(c.src+iDone,iNext-iDone,c.dst+oDone,oNext-oDone);
+
+		double sec = 0.0;
+		if (rbw > 0)
+			sec = max(sec,double(iNext-iDone)/rbw);
+		if (wbw > 0)
+			sec = max(sec,double(oNext-oDone)/wbw);
+
+		t += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(sec));
+		this_thread::sleep_until(t);
+
+		m_iBytes += iNext-iDone;
+		m_oBytes += oNext-oDone;
+		iDone = iNext;
+		oDone = oNext;
+	}
+
+	// the write stream holds the next chunk's output until this chunk's last writes are acknowledged, so chunks don't overlap
+	this_thread::sleep_until(t + m_cfg.memoryLatency);
+}
+
+// With memory latency, a stream with n lines in flight moves at most n lines per latency (Little's law); 0 = unlimited
+double BlockMapEmulator::streamBandwidth(const double bw,const unsigned tags,const unsigned buffers) const
+{
+	if (m_cfg.memoryLatency.count() == 0)
+		return bw;
+
+	const double latBW = min(tags,buffers)*128.0/chrono::duration<double>(m_cfg.memoryLatency).count();
+	return bw > 0 ? min(bw,latBW) : latBW;
+}
+
+void BlockMapEmulator::fillWorker()
+{
+	for(;;)
+	{
+		Fill f;
+		{
+			unique_lock<mutex> L(m_mutex);
+			m_cv.wait(L,[this]{ return m_terminate || !m_fills.empty(); });
+			if (m_terminate)
+				return;
+			f = m_fills.front();
+			m_fills.pop_front();
+			m_fillBusy = true;
+		}
+
+		const double bw = f.zero ? m_cfg.zeroBandwidth : m_cfg.writeBandwidth;
+		auto t = chrono::steady_clock::now() + m_cfg.chunkLatency;
+
+		for(size_t i=0;i<f.size && !m_detached;i+=m_cfg.burstBytes)
+		{
+			const size_t n = min(m_cfg.burstBytes,f.size-i);
+
+			if (f.zero)
+				memset(f.dst+i,0,n);
+			else
+				for(size_t j=0;j<n;j+=8)
+					memcpy(f.dst+i+j,&f.pattern,8);
+
+			if (bw > 0)
+				t += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(n/bw));
+			this_thread::sleep_until(t);
+		}
+
+		{
+			lock_guard<mutex> L(m_mutex);
+			++m_fillsDone;
+			m_fillBusy = false;
+		}
+	}
+}
@@ -0,0 +1,153 @@
+/*
+ * BlockMapEmulator.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BLOCKMAPEMULATOR_HPP_
+#define BLOCKMAPEMULATOR_HPP_
+
+#include "AFUBackend.hpp"
+#include "BlockMapAFUBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/** Software model of mkBlockMapAFU for running host code without hardware (device string "emu:blockmap[:<args>]").
+ *
+ * Implements the same WED, status/MMIO map (including chunked mode) and completion interrupt as the hardware. A worker thread
+ * moves data between the host buffers in bursts, pacing itself to the configured bandwidth and adding a fixed latency at the
+ * start of each chunk. As in hardware, chunks run one after another without overlapping: each ends one memory latency (mlat)
+ * after its last burst, when its final writes would be acknowledged. The map function defaults to a copy (output zero-padded or truncated to the output size). Fills run on a
+ * second thread, independently of the map, as they do on their own command port in hardware.
+ *
+ * Args are comma-separated key=value pairs:
+ *      rbw=<bytes/s>       read bandwidth (default 3.2e9, 0=unlimited)
+ *      wbw=<bytes/s>       write bandwidth (default 3.2e9, 0=unlimited)
+ *      lat=<ns>            latency added at the start of each chunk (default 2000)
+ *      mmio=<ns>           latency added to each MMIO access (default 0)
+ *      burst=<bytes>       transfer granularity (default 4096)
+ *      zbw=<bytes/s>       zero fill (zero_m) bandwidth (default 6.4e9, 0=unlimited); pattern fills use wbw
+ *      clk=<Hz>            rate of the cycle counter and event timestamps at 0x48-0x70 (default 250e6)
+ *      mlat=<ns>           memory latency per command (default 0): caps each stream at min(tags,buffers)*128B per mlat, using
+ *                          the stream tuning at 0x80 (synthesized maxima at 0x88 as for Examples/AFUMemcpy: 16/32 read, 30/32 write)
+ */
+
+class BlockMapEmulator : public AFUBackend
+{
+public:
+	/// Map function: transforms iBytes of input into oBytes of output (one burst at a time)
+	typedef std::function<void(const uint8_t* in,std::size_t iBytes,uint8_t* out,std::size_t oBytes)> MapFunction;
+
+	struct Config
+	{
+		double						readBandwidth=3.2e9;
+		double						writeBandwidth=3.2e9;
+		std::chrono::nanoseconds	chunkLatency=std::chrono::nanoseconds(2000);
+		std::chrono::nanoseconds	mmioLatency=std::chrono::nanoseconds(0);
+		std::size_t					burstBytes=4096;
+		double						zeroBandwidth=6.4e9;
+		double						clockHz=250e6;
+		std::chrono::nanoseconds	memoryLatency=std::chrono::nanoseconds(0);
+		BlockMapAFUBase::StreamTuning	streamMax=BlockMapAFUBase::StreamTuning(4,32,30,32);	// MMIO 0x88; 4 read tags as mkBlockMapAFU
+		MapFunction					map;
+	};
+
+	explicit BlockMapEmulator(const std::string& args="");
+	explicit BlockMapEmulator(const Config& cfg);
+	~BlockMapEmulator();
+
+	virtual void attach(void* wed) override;
+
+	virtual uint64_t mmio_read64(unsigned offset) override;
+	virtual void mmio_write64(unsigned offset,uint64_t data) override;
+
+	virtual AFU::Event await_event(unsigned timeout_ms) override;
+
+	virtual std::string description() const override;
+
+	static void copyMap(const uint8_t* in,std::size_t iBytes,uint8_t* out,std::size_t oBytes);
+
+private:
+	struct Chunk
+	{
+		const uint8_t*	src;
+		std::size_t		iSize;
+		uint8_t*		dst;
+		std::size_t		oSize;
+		bool			last;
+	};
+
+	struct Fill
+	{
+		uint8_t*		dst;
+		std::size_t		size;
+		bool			zero;
+		uint64_t		pattern;
+	};
+
+	void worker();
+	void queueChunk(const Chunk& c);
+	void runChunk(const Chunk& c);
+	void fillWorker();
+	void queueFill(const Fill& f);
+	void mmioDelay() const;
+	uint64_t cycles() const;
+	double streamBandwidth(double bw,unsigned tags,unsigned buffers) const;
+
+	Config							m_cfg;
+
+	BlockMapWED						m_wed;
+	Chunk							m_stage{nullptr,0,nullptr,0,false};
+
+	std::atomic<unsigned>			m_status{BlockMapAFUBase::Resetting};
+	std::atomic<uint64_t>			m_iBytes{0},m_oBytes{0};
+	std::atomic<unsigned>			m_oChunksDone{0};
+	std::atomic<unsigned>			m_fillsDone{0};
+	uint64_t						m_stagePattern=0;
+	std::atomic<uint64_t>			m_tuneReq{0};			// as written to 0x80
+	std::atomic<uint64_t>			m_tuning{0};			// in effect (clamped), latched at each chunk start
+
+	const std::chrono::steady_clock::time_point	m_reset=std::chrono::steady_clock::now();	// cycle counter origin
+	std::atomic<uint64_t>			m_tsWED{0},m_tsStart{0},m_tsIDone{0},m_tsODone{0},m_tsDone{0};
+
+	std::mutex						m_mutex;
+	std::condition_variable			m_cv;
+	std::deque<Chunk>				m_chunks;
+	std::deque<AFU::Event>			m_events;
+	bool							m_terminate=false;
+	std::atomic<bool>				m_detached{false};		// backend being destroyed (AFU detached)
+	bool							m_busy=false;			// worker is running a chunk (popped from m_chunks)
+	std::deque<Fill>				m_fills;
+	bool							m_fillBusy=false;
+
+	std::thread						m_thread;
+	std::thread						m_fillThread;
+
+	static constexpr std::size_t	chunkQueueDepth=BlockMapAFUBase::ChunkQueueDepth;
+	static constexpr std::size_t	fillQueueDepth=BlockMapAFUBase::FillQueueDepth;
+};
+
+/** Software model of the Examples/Memcopy and Examples/MemcopyStream AFUs (device string "emu:memcopy[:<args>]").
+ *
+ * Takes their WED (source address, destination address, size) and runs the copy as a BlockMapEmulator with equal input and
+ * output sizes. Status at 0x00 and the start/terminate commands match those AFUs; other registers follow mkBlockMapAFU. Args
+ * are as for BlockMapEmulator.
+ */
+
+class MemcopyEmulator : public BlockMapEmulator
+{
+public:
+	explicit MemcopyEmulator(const std::string& args="") : BlockMapEmulator(args){}
+
+	virtual void attach(void* wed) override;
+
+	virtual std::string description() const override;
+};
+
+#endif /* BLOCKMAPEMULATOR_HPP_ */
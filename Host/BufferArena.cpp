@@ -0,0 +1,106 @@
+/*
+ * BufferArena.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "BufferArena.hpp"
+
+#include <algorithm>
+
+#include <unistd.h>
+
+using namespace std;
+
+BufferArena::Block::Block(Block&& b) :
+	m_arena(b.m_arena),
+	m_p(b.m_p),
+	m_capacity(b.m_capacity)
+{
+	b.m_arena=nullptr;
+	b.m_p=nullptr;
+	b.m_capacity=0;
+}
+
+BufferArena::Block& BufferArena::Block::operator=(Block&& b)
+{
+	if (&b != this)
+	{
+		release();
+		swap(m_arena,b.m_arena);
+		swap(m_p,b.m_p);
+		swap(m_capacity,b.m_capacity);
+	}
+	return *this;
+}
+
+void BufferArena::Block::release()
+{
+	if (m_p)
+		m_arena->giveBack(m_p,m_capacity);
+	m_arena=nullptr;
+	m_p=nullptr;
+	m_capacity=0;
+}
+
+
+
+BufferArena::BufferArena(const PinnedAllocPolicy& policy) :
+	m_policy(policy)
+{
+	m_policy.prefaultThreads = max(m_policy.prefaultThreads,1U);
+}
+
+BufferArena::~BufferArena()
+{
+	trim();
+}
+
+BufferArena::Block BufferArena::acquire(std::size_t bytes)
+{
+	const std::size_t pageBytes = page_bytes(m_policy.backing);
+	bytes = (max(bytes,std::size_t(1))+pageBytes-1)/pageBytes*pageBytes;
+
+	{
+		lock_guard<mutex> L(m_mutex);
+		auto it = m_idle.lower_bound(bytes);
+
+		if (it != m_idle.end() && it->first < 2*bytes)
+		{
+			Block b(this,it->second,it->first);
+			m_idle.erase(it);
+			return b;
+		}
+	}
+
+	return Block(this,pinned_alloc(bytes,m_policy),bytes);
+}
+
+void BufferArena::giveBack(void* p,std::size_t capacity)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_idle.insert(make_pair(capacity,p));
+}
+
+void BufferArena::trim()
+{
+	lock_guard<mutex> L(m_mutex);
+	for(const auto& b : m_idle)
+		pinned_free(b.second,b.first,m_policy);
+	m_idle.clear();
+}
+
+std::size_t BufferArena::idleBytes() const
+{
+	lock_guard<mutex> L(m_mutex);
+	std::size_t sum=0;
+	for(const auto& b : m_idle)
+		sum += b.first;
+	return sum;
+}
+
+std::size_t BufferArena::idleBlocks() const
+{
+	lock_guard<mutex> L(m_mutex);
+	return m_idle.size();
+}
@@ -0,0 +1,87 @@
+/*
+ * BufferArena.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef BUFFERARENA_HPP_
+#define BUFFERARENA_HPP_
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+#include <boost/range/iterator_range.hpp>
+
+#include "pinned_allocator.hpp"
+
+/** Recycling pool of AFU buffers.
+ *
+ * Blocks come from pinned_alloc (page-aligned, so at least 128B-aligned as the PSL requires) and are prefaulted when first
+ * allocated. When a Block is released it goes back to the arena's free list rather than being unmapped, so a stream of
+ * same-shaped jobs pays allocation and first-touch faults once. acquire() returns the smallest idle block that fits, provided
+ * it is less than twice the requested size.
+ *
+ * The arena must outlive all Blocks acquired from it. Thread-safe.
+ */
+
+class BufferArena
+{
+public:
+	class Block
+	{
+	public:
+		Block(){}
+		Block(Block&& b);
+		Block(const Block&)=delete;
+		~Block(){ release(); }
+
+		Block& operator=(Block&& b);
+		Block& operator=(const Block&)=delete;
+
+		void* 				data() 			const { return m_p; }
+		std::size_t 		capacity() 		const { return m_capacity; }
+		explicit operator 	bool() 			const { return m_p; }
+
+		template<typename T>T* as() const { return static_cast<T*>(m_p); }
+
+		/// Typed view of the first N elements (N*sizeof(T) must not exceed capacity)
+		template<typename T>boost::iterator_range<T*> span(std::size_t N) const
+			{ return boost::iterator_range<T*>(as<T>(),as<T>()+N); }
+
+		void release();		///< Return to the arena (no-op if empty)
+
+	private:
+		Block(BufferArena* a,void* p,std::size_t capacity) : m_arena(a),m_p(p),m_capacity(capacity){}
+
+		BufferArena*	m_arena=nullptr;
+		void*			m_p=nullptr;
+		std::size_t		m_capacity=0;
+
+		friend class BufferArena;
+	};
+
+	/// Policy used for new blocks; prefaultThreads is raised to at least 1 so recycled blocks are always resident
+	explicit BufferArena(const PinnedAllocPolicy& policy=PinnedAllocPolicy());
+	~BufferArena();
+
+	BufferArena(const BufferArena&)=delete;
+	BufferArena& operator=(const BufferArena&)=delete;
+
+	Block acquire(std::size_t bytes);
+
+	void trim();						///< Unmap all idle blocks
+
+	std::size_t idleBytes() const;
+	std::size_t idleBlocks() const;
+
+private:
+	void giveBack(void* p,std::size_t capacity);
+
+	PinnedAllocPolicy					m_policy;
+
+	mutable std::mutex					m_mutex;
+	std::multimap<std::size_t,void*>	m_idle;				// capacity -> block
+};
+
+#endif /* BUFFERARENA_HPP_ */
@@ -0,0 +1,51 @@
+/*
+ * LineCompare.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "LineCompare.hpp"
+
+#include <cinttypes>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline bool lineDiffers(const void* a,const void* b)
+{
+#ifdef __SSE2__
+	const __m128i* va = static_cast<const __m128i*>(a);
+	const __m128i* vb = static_cast<const __m128i*>(b);
+
+	__m128i acc = _mm_setzero_si128();
+	for(unsigned i=0;i<CacheLineBytes/16;++i)
+		acc = _mm_or_si128(acc,_mm_xor_si128(_mm_loadu_si128(va+i),_mm_loadu_si128(vb+i)));
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(acc,_mm_setzero_si128())) != 0xffff;
+#else
+	const uint64_t* wa = static_cast<const uint64_t*>(a);
+	const uint64_t* wb = static_cast<const uint64_t*>(b);
+
+	uint64_t acc=0;
+	for(unsigned i=0;i<CacheLineBytes/8;++i)
+		acc |= wa[i] ^ wb[i];
+
+	return acc != 0;
+#endif
+}
+
+}
+
+std::size_t first_mismatched_line(const void* a,const void* b,std::size_t i0,const std::size_t nLines)
+{
+	const char* ca = static_cast<const char*>(a);
+	const char* cb = static_cast<const char*>(b);
+
+	for(std::size_t i=i0;i<nLines;++i)
+		if (lineDiffers(ca+i*CacheLineBytes,cb+i*CacheLineBytes))
+			return i;
+	return nLines;
+}
@@ -0,0 +1,22 @@
+/*
+ * LineCompare.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef LINECOMPARE_HPP_
+#define LINECOMPARE_HPP_
+
+#include <cstddef>
+
+/** Bit-exact comparison of buffers one PSL cache line at a time (SSE2 where available, otherwise a 64b-word
+ * reduction the compiler vectorizes, eg. VSX on POWER8).
+ *
+ * Returns the index of the first line at or after line i0 where a and b differ, or nLines if they match.
+ */
+
+std::size_t first_mismatched_line(const void* a,const void* b,std::size_t i0,std::size_t nLines);
+
+static constexpr std::size_t CacheLineBytes=128;
+
+#endif /* LINECOMPARE_HPP_ */
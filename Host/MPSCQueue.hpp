@@ -0,0 +1,73 @@
+/*
+ * MPSCQueue.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MPSCQUEUE_HPP_
+#define MPSCQUEUE_HPP_
+
+#include <atomic>
+#include <utility>
+
+/** Unbounded multi-producer single-consumer FIFO (Vyukov's linked queue with a stub node).
+ *
+ * push() is wait-free apart from allocating the node: one atomic exchange to claim the head, then a store linking the previous
+ * node. pop() and empty() may only be called from the single consumer thread; between a producer's exchange and its link store
+ * the element isn't visible yet, so pop() can briefly report empty while a push is in progress. T must be default-constructible
+ * (for the stub) and movable.
+ */
+
+template<typename T>class MPSCQueue
+{
+public:
+	MPSCQueue() : m_head(new Node()), m_tail(m_head.load()){}
+
+	~MPSCQueue()
+	{
+		T x;
+		while(pop(x)){}
+		delete m_tail;
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	void push(T&& x)
+	{
+		Node* n = new Node(std::move(x));
+		Node* prev = m_head.exchange(n,std::memory_order_acq_rel);
+		prev->next.store(n,std::memory_order_release);
+	}
+
+	/// Consumer only: move the oldest element into x and return true, or return false if none is visible
+	bool pop(T& x)
+	{
+		Node* next = m_tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+
+		x = std::move(next->value);
+		delete m_tail;
+		m_tail = next;				// next becomes the stub
+		return true;
+	}
+
+	/// Consumer only
+	bool empty() const { return m_tail->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+	struct Node
+	{
+		Node(){}
+		explicit Node(T&& x) : value(std::move(x)){}
+
+		std::atomic<Node*>	next{nullptr};
+		T					value;
+	};
+
+	std::atomic<Node*>	m_head;			// most recently pushed
+	Node*				m_tail;			// stub: its successor is the oldest element
+};
+
+#endif /* MPSCQUEUE_HPP_ */
@@ -0,0 +1,167 @@
+/*
+ * MappedFile.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "MappedFile.hpp"
+#include "pinned_allocator.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+std::size_t roundUp(std::size_t x,std::size_t m){ return (x+m-1)/m*m; }
+
+}
+
+MappedFile::MappedFile(const std::string& path,const Mode mode,const std::size_t bytes,const std::size_t offset) :
+	m_path(path),
+	m_mode(mode)
+{
+	const std::size_t pageBytes = sysconf(_SC_PAGESIZE);
+	const std::size_t regionOffset = mode == Read ? offset : 0;
+	const std::size_t mapOffset = regionOffset/pageBytes*pageBytes;
+
+	if (mode == Read)
+	{
+		if (offset % 128 != 0)
+			throw std::logic_error("MappedFile: unaligned file offset");
+
+		if ((m_fd = ::open(path.c_str(),O_RDONLY)) < 0)
+			throw OpenFail(path+": "+strerror(errno));
+
+		struct stat st;
+		if (fstat(m_fd,&st) != 0)
+		{
+			const int err=errno;
+			::close(m_fd);
+			throw OpenFail(path+": "+strerror(err));
+		}
+
+		const std::size_t fileBytes = st.st_size;
+		m_size = bytes ? bytes : fileBytes-std::min(offset,fileBytes);
+
+		if (offset+m_size > fileBytes)
+		{
+			::close(m_fd);
+			throw OpenFail(path+": region extends past end of file");
+		}
+	}
+	else
+	{
+		m_size = bytes;
+
+		if ((m_fd = ::open(path.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644)) < 0)
+			throw OpenFail(path+": "+strerror(errno));
+
+		// allocate the blocks now so AFU writes don't fail for lack of space (or fault in a sparse file) mid-stream
+		const int err = posix_fallocate(m_fd,0,roundUp(m_size,128));
+		if (err != 0 && ftruncate(m_fd,roundUp(m_size,128)) != 0)
+		{
+			::close(m_fd);
+			throw OpenFail(path+": "+strerror(err));
+		}
+	}
+
+	m_padded = roundUp(m_size,128);
+
+	if (m_padded == 0)
+		return;
+
+	m_mapBytes = regionOffset-mapOffset+m_padded;
+
+	m_map = mmap(nullptr,m_mapBytes,PROT_READ|PROT_WRITE,mode == Read ? MAP_PRIVATE : MAP_SHARED,m_fd,mapOffset);
+	if (m_map == MAP_FAILED)
+	{
+		const int err=errno;
+		m_map=nullptr;
+		::close(m_fd);
+		throw OpenFail(path+": mmap failed: "+strerror(err));
+	}
+
+	m_data = static_cast<char*>(m_map)+(regionOffset-mapOffset);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& f)
+{
+	swap(f);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& f)
+{
+	close();
+	swap(f);
+	return *this;
+}
+
+void MappedFile::swap(MappedFile& f)
+{
+	std::swap(m_path,f.m_path);
+	std::swap(m_mode,f.m_mode);
+	std::swap(m_fd,f.m_fd);
+	std::swap(m_map,f.m_map);
+	std::swap(m_mapBytes,f.m_mapBytes);
+	std::swap(m_data,f.m_data);
+	std::swap(m_size,f.m_size);
+	std::swap(m_padded,f.m_padded);
+}
+
+void MappedFile::adviseSequential()
+{
+	if (m_map)
+		madvise(m_map,m_mapBytes,MADV_SEQUENTIAL);
+	if (m_fd >= 0)
+		posix_fadvise(m_fd,0,0,POSIX_FADV_SEQUENTIAL);
+}
+
+void MappedFile::willNeed()
+{
+	if (m_map)
+		madvise(m_map,m_mapBytes,MADV_WILLNEED);
+}
+
+void MappedFile::prefault(unsigned nThreads)
+{
+	if (m_map)
+		::prefault(m_map,m_mapBytes,sysconf(_SC_PAGESIZE),nThreads,m_mode == Write);
+}
+
+void MappedFile::sync()
+{
+	if (m_map && m_mode == Write && msync(m_map,m_mapBytes,MS_SYNC) != 0)
+		BLUELINK_TRACE(MappedSyncFailed,m_fd,errno);
+}
+
+void MappedFile::close()
+{
+	if (m_map)
+		munmap(m_map,m_mapBytes);
+
+	// drop the cache-line padding from the output file
+	if (m_fd >= 0 && m_mode == Write && ftruncate(m_fd,m_size) != 0)
+		BLUELINK_TRACE(MappedTruncateFailed,m_fd,m_size,errno);
+
+	if (m_fd >= 0)
+		::close(m_fd);
+
+	m_fd = -1;
+	m_map = m_data = nullptr;
+	m_mapBytes = m_size = m_padded = 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * MappedFile.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <exception>
+#include <string>
+
+/** Memory-mapped file region usable directly as an AFU source or destination (no copy through an intermediate buffer).
+ *
+ * Read     Maps an existing file region copy-on-write: the AFU and host read the page cache directly, and host writes (if any)
+ *          go to private copies of the pages, never to the file. The offset must be a multiple of 128B so the region starts on
+ *          a cache line. The mapping is padded up to the next cache line, which is always within the page holding the end of
+ *          the region; padding beyond end of file reads as zero.
+ *
+ * Write    Creates (or truncates) the file and allocates it with the region size rounded up to a whole cache line, so the AFU
+ *          can write its last line in place; close() (or destruction) flushes and truncates the file back to size().
+ *
+ * Pages are faulted on first touch (by the PSL for AFU accesses) unless prefault() is called. For multi-GB streaming input,
+ * adviseSequential() + willNeed() let the kernel read ahead of the AFU.
+ */
+
+class MappedFile
+{
+public:
+	enum Mode { Read, Write };
+
+	MappedFile(){}
+
+	/// Read: maps bytes from offset (bytes=0 -> to end of file). Write: creates the file with the given size (offset ignored).
+	MappedFile(const std::string& path,Mode mode,std::size_t bytes=0,std::size_t offset=0);
+	~MappedFile();
+
+	MappedFile(MappedFile&& f);
+	MappedFile& operator=(MappedFile&& f);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	void*					data()			{ return m_data; }
+	const void*				data() const	{ return m_data; }
+
+	template<typename T>T*			as()		{ return static_cast<T*>(m_data); }
+	template<typename T>const T*	as() const	{ return static_cast<const T*>(m_data); }
+
+	std::size_t				size() const		{ return m_size; }			///< Region size in bytes
+	std::size_t				paddedSize() const	{ return m_padded; }		///< Accessible bytes (size rounded up to 128B)
+
+	Mode					mode() const { return m_mode; }
+	bool					isOpen() const { return m_data != nullptr; }
+
+	void	adviseSequential();						///< Expect a single front-to-back pass (more aggressive readahead)
+	void	willNeed();							///< Start reading the whole region into the page cache asynchronously
+	void	prefault(unsigned nThreads=1);			///< Fault in every page now (read touch for Read, write touch for Write)
+
+	void	sync();									///< Write mapped output back to the file (blocking)
+	void	close();
+
+	class OpenFail;
+
+private:
+	void swap(MappedFile& f);
+
+	std::string		m_path;
+	Mode			m_mode=Read;
+	int				m_fd=-1;
+
+	void*			m_map=nullptr;		// page-aligned mapping as returned by mmap
+	std::size_t		m_mapBytes=0;
+
+	void*			m_data=nullptr;		// start of the region within the mapping
+	std::size_t		m_size=0;
+	std::size_t		m_padded=0;
+};
+
+class MappedFile::OpenFail : public std::exception {
+public:
+	OpenFail(const std::string what) : s("MappedFile::OpenFail "+what){}
+	virtual const char* what() const noexcept { return s.c_str(); }
+
+private:
+	std::string s;
+};
+
+#endif /* MAPPEDFILE_HPP_ */
@@ -0,0 +1,215 @@
+/*
+ * Profiler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Profiler.hpp"
+#include "AFU.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include <time.h>
+
+using namespace std;
+
+namespace {
+
+// The fitted rate is only trusted once samples are far enough apart for MMIO jitter not to dominate it
+const int64_t minFitSpan_ns = 100000;
+
+void writeJSONString(ostream& os,const string& s)
+{
+	os << '"';
+	for(char c : s)
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+			os << "\\u" << hex << setw(4) << setfill('0') << unsigned(c) << dec << setfill(' ');
+		else
+			os << c;
+	os << '"';
+}
+
+// Chrome trace times are in microseconds
+void writeMicroseconds(ostream& os,int64_t ns)
+{
+	if (ns < 0)
+	{
+		os << '-';
+		ns = -ns;
+	}
+	os << ns/1000 << '.' << setw(3) << setfill('0') << ns%1000 << setfill(' ');
+}
+
+}
+
+void AFUClockSync::sample(const AFU& afu,const unsigned offset,const unsigned nReads)
+{
+	Sample best{0,0,numeric_limits<int64_t>::max()};
+
+	for(unsigned i=0;i<max(nReads,1U);++i)
+	{
+		const int64_t t0 = Profiler::now();
+		const uint64_t c = afu.mmio_read64(offset);
+		const int64_t t1 = Profiler::now();
+
+		if ((t1-t0)/2 < best.halfWidth_ns)
+			best = Sample{c,t0+(t1-t0)/2,(t1-t0)/2};
+	}
+
+	if (!m_samples.empty() && best.cycles < m_samples.back().cycles)
+		m_samples.clear();
+
+	m_samples.push_back(best);
+}
+
+double AFUClockSync::hz() const
+{
+	if (m_samples.size() < 2 || m_samples.back().host_ns-m_samples.front().host_ns < minFitSpan_ns)
+		return m_nominalHz;
+
+	return double(m_samples.back().cycles-m_samples.front().cycles)*1e9/double(m_samples.back().host_ns-m_samples.front().host_ns);
+}
+
+int64_t AFUClockSync::uncertainty_ns() const
+{
+	return m_samples.empty() ? 0 : max(m_samples.front().halfWidth_ns,m_samples.back().halfWidth_ns);
+}
+
+int64_t AFUClockSync::toHostNs(const uint64_t cycles) const
+{
+	if (m_samples.empty())
+		return 0;
+
+	const Sample& s = m_samples.front();
+	return s.host_ns + int64_t(double(int64_t(cycles-s.cycles))*1e9/hz());
+}
+
+
+
+Profiler::Profiler() :
+	m_origin(now())
+{
+}
+
+int64_t Profiler::now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return int64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
+
+unsigned Profiler::hostTrack()
+{
+	return m_threads.insert(make_pair(this_thread::get_id(),unsigned(m_threads.size()+1))).first->second;
+}
+
+unsigned Profiler::afuTrack(const std::string& name)
+{
+	return m_afuTracks.insert(make_pair(name,unsigned(m_afuTracks.size()+1))).first->second;
+}
+
+void Profiler::threadName(const std::string& name)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_hostTrackNames[hostTrack()] = name;
+}
+
+void Profiler::hostSpan(const std::string& name,const int64_t t0_ns,const int64_t t1_ns)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_events.push_back(Event{ name, 'X', Host, hostTrack(), t0_ns, t1_ns-t0_ns });
+}
+
+void Profiler::hostEvent(const std::string& name,const int64_t t_ns)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_events.push_back(Event{ name, 'i', Host, hostTrack(), t_ns, 0 });
+}
+
+void Profiler::afuSpan(const std::string& track,const std::string& name,const uint64_t c0,const uint64_t c1)
+{
+	lock_guard<mutex> L(m_mutex);
+	const int64_t t0 = m_clock.toHostNs(c0);
+	m_events.push_back(Event{ name, 'X', AFUProcess, afuTrack(track), t0, m_clock.toHostNs(c1)-t0 });
+}
+
+void Profiler::afuEvent(const std::string& track,const std::string& name,const uint64_t c)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_events.push_back(Event{ name, 'i', AFUProcess, afuTrack(track), m_clock.toHostNs(c), 0 });
+}
+
+std::size_t Profiler::events() const
+{
+	lock_guard<mutex> L(m_mutex);
+	return m_events.size();
+}
+
+void Profiler::clear()
+{
+	lock_guard<mutex> L(m_mutex);
+	m_events.clear();
+}
+
+void Profiler::writeChromeTrace(std::ostream& os) const
+{
+	lock_guard<mutex> L(m_mutex);
+
+	os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << endl;
+
+	// track names
+	os << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << Host << ",\"tid\":0,\"args\":{\"name\":\"Host\"}}," << endl;
+	os << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << AFUProcess << ",\"tid\":0,\"args\":{\"name\":\"AFU\"}}";
+
+	for(const auto& t : m_threads)
+	{
+		const auto it = m_hostTrackNames.find(t.second);
+		os << ',' << endl << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << Host << ",\"tid\":" << t.second << ",\"args\":{\"name\":";
+		writeJSONString(os,it == m_hostTrackNames.end() ? "thread " + to_string(t.second) : it->second);
+		os << "}}";
+	}
+
+	for(const auto& t : m_afuTracks)
+	{
+		os << ',' << endl << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << AFUProcess << ",\"tid\":" << t.second << ",\"args\":{\"name\":";
+		writeJSONString(os,t.first);
+		os << "}}";
+	}
+
+	for(const Event& e : m_events)
+	{
+		os << ',' << endl << "{\"ph\":\"" << e.phase << "\",\"name\":";
+		writeJSONString(os,e.name);
+		os << ",\"pid\":" << e.pid << ",\"tid\":" << e.tid << ",\"ts\":";
+		writeMicroseconds(os,e.t_ns-m_origin);
+
+		if (e.phase == 'X')
+		{
+			os << ",\"dur\":";
+			writeMicroseconds(os,e.dur_ns);
+		}
+		else
+			os << ",\"s\":\"t\"";
+		os << '}';
+	}
+
+	os << endl << "]}" << endl;
+}
+
+bool Profiler::writeChromeTrace(const std::string& fn) const
+{
+	ofstream os(fn.c_str());
+	if (!os)
+	{
+		BLUELINK_TRACE(ProfilerOpenFailed,errno);
+		return false;
+	}
+	writeChromeTrace(os);
+	return bool(os);
+}
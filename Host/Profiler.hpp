@@ -0,0 +1,143 @@
+/*
+ * Profiler.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <cinttypes>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AFU;
+
+/** Maps an AFU's free-running cycle counter onto the host's CLOCK_MONOTONIC.
+ *
+ * Each sample() reads the counter register several times, bracketing each read with host clock reads, and keeps the tightest
+ * bracket: the counter value is taken to belong to the bracket's midpoint, with half its width as the uncertainty (mostly MMIO
+ * latency). With one sample the nominal clock rate is assumed; with two or more, the rate is fitted between the first and the
+ * latest, so a sample before and after a job is enough to cover it accurately. A counter value lower than the last sample means
+ * the AFU was reset, and starts over.
+ */
+
+class AFUClockSync
+{
+public:
+	explicit AFUClockSync(double nominalHz=250e6) : m_nominalHz(nominalHz){}
+
+	void		reset(){ m_samples.clear(); }
+
+	/// Add a sample of the 64b counter at byte offset (eg. 0x48 for mkBlockMapAFU) using the tightest of nReads brackets
+	void		sample(const AFU& afu,unsigned offset,unsigned nReads=8);
+
+	bool		valid() const { return !m_samples.empty(); }
+	double		hz() const;											///< Fitted counter rate (nominal until there are two samples)
+	int64_t		uncertainty_ns() const;								///< Half-width of the widest bracket used in the fit
+
+	int64_t		toHostNs(uint64_t cycles) const;					///< Counter value to CLOCK_MONOTONIC ns (0 if no samples)
+
+private:
+	struct Sample
+	{
+		uint64_t	cycles;
+		int64_t		host_ns;			// bracket midpoint
+		int64_t		halfWidth_ns;
+	};
+
+	double					m_nominalHz;
+	std::vector<Sample>		m_samples;
+};
+
+
+
+/** Timeline of host phases and AFU events, exported as a Chrome trace (JSON, viewable in chrome://tracing or Perfetto).
+ *
+ * Host spans are recorded per thread, either with the RAII Span or explicitly with start/end times from now(). AFU events are
+ * given as cycle timestamps and converted with clock(), so it must have been sampled against the same AFU since its last reset;
+ * each AFU event goes on a named track. Times are CLOCK_MONOTONIC ns throughout, written relative to the profiler's creation.
+ * Recording is thread-safe (one mutex).
+ *
+ *   Profiler prof;
+ *   afu.profiler(&prof);						// BlockMapAFUBase records attach/run and the AFU's own timestamps
+ *   { Profiler::Span s(&prof,"pack"); ... }
+ *   prof.writeChromeTrace("job.trace.json");
+ */
+
+class Profiler
+{
+public:
+	Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static int64_t now();										///< CLOCK_MONOTONIC in ns
+
+	/// Records a host span on the calling thread from construction to destruction (no-op if the profiler is null)
+	class Span
+	{
+	public:
+		Span(Profiler* p,const char* name) : m_profiler(p),m_name(name),m_t0(p ? now() : 0){}
+		~Span(){ if (m_profiler) m_profiler->hostSpan(m_name,m_t0,now()); }
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		Profiler*	m_profiler;
+		const char*	m_name;
+		int64_t		m_t0;
+	};
+
+	void				threadName(const std::string& name);	///< Label the calling thread's track
+
+	void				hostSpan(const std::string& name,int64_t t0_ns,int64_t t1_ns);
+	void				hostEvent(const std::string& name,int64_t t_ns=now());
+
+	void				afuSpan(const std::string& track,const std::string& name,uint64_t c0,uint64_t c1);
+	void				afuEvent(const std::string& track,const std::string& name,uint64_t c);
+
+	AFUClockSync&		clock()			{ return m_clock; }
+	const AFUClockSync&	clock() const	{ return m_clock; }
+
+	std::size_t			events() const;
+	void				clear();
+
+	void				writeChromeTrace(std::ostream& os) const;
+	bool				writeChromeTrace(const std::string& fn) const;		///< False if the file can't be written
+
+private:
+	enum Process { Host=1, AFUProcess=2 };
+
+	struct Event
+	{
+		std::string		name;
+		char			phase;					// 'X' complete span, 'i' instant
+		Process			pid;
+		unsigned		tid;
+		int64_t			t_ns;
+		int64_t			dur_ns;
+	};
+
+	unsigned			hostTrack();			// calling thread's track (m_mutex held)
+	unsigned			afuTrack(const std::string& name);
+
+	const int64_t							m_origin;
+
+	mutable std::mutex						m_mutex;
+	std::vector<Event>						m_events;
+
+	std::map<std::thread::id,unsigned>		m_threads;
+	std::map<unsigned,std::string>			m_hostTrackNames;
+	std::map<std::string,unsigned>			m_afuTracks;
+
+	AFUClockSync							m_clock;
+};
+
+#endif /* PROFILER_HPP_ */
@@ -0,0 +1,77 @@
+/*
+ * SPSCRing.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPSCRING_HPP_
+#define SPSCRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/** Bounded single-producer single-consumer ring buffer.
+ *
+ * Lock-free and wait-free: the producer only writes the head and the consumer only the tail, each published with a release
+ * store and read with an acquire load. Capacity is rounded up to a power of two. push() fails rather than overwriting when the
+ * ring is full, so the consumer never sees a torn element. T must be default-constructible and copyable.
+ */
+
+template<typename T>class SPSCRing
+{
+public:
+	explicit SPSCRing(std::size_t capacity) : m_buf(roundUp(capacity)), m_mask(m_buf.size()-1){}
+
+	SPSCRing(const SPSCRing&) = delete;
+	SPSCRing& operator=(const SPSCRing&) = delete;
+
+	/// Producer only: returns false (and drops x) if full
+	bool push(const T& x)
+	{
+		const std::size_t h = m_head.load(std::memory_order_relaxed);
+		if (h - m_tail.load(std::memory_order_acquire) == m_buf.size())
+			return false;
+
+		m_buf[h & m_mask] = x;
+		m_head.store(h+1,std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer only: move the oldest element into x and return true, or return false if empty
+	bool pop(T& x)
+	{
+		const std::size_t t = m_tail.load(std::memory_order_relaxed);
+		if (t == m_head.load(std::memory_order_acquire))
+			return false;
+
+		x = m_buf[t & m_mask];
+		m_tail.store(t+1,std::memory_order_release);
+		return true;
+	}
+
+	std::size_t capacity() const { return m_buf.size(); }
+
+	/// Approximate when called concurrently with push/pop
+	std::size_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+
+private:
+	static std::size_t roundUp(std::size_t n)
+	{
+		std::size_t c=1;
+		while(c < n)
+			c <<= 1;
+		return c;
+	}
+
+	std::vector<T>					m_buf;
+	const std::size_t				m_mask;
+
+	// head and tail on separate cache lines so producer and consumer don't contend
+	char							m_pad0[64];
+	std::atomic<std::size_t>		m_head{0};		// next slot to write (producer)
+	char							m_pad1[64];
+	std::atomic<std::size_t>		m_tail{0};		// next slot to read (consumer)
+};
+
+#endif /* SPSCRING_HPP_ */
@@ -0,0 +1,118 @@
+/*
+ * StreamTuner.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "StreamTuner.hpp"
+#include "Trace.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// 1, 2, 4 ... below max, then max itself
+vector<unsigned> candidates(unsigned max)
+{
+	vector<unsigned> v;
+	for(unsigned x=1; x<max; x <<= 1)
+		v.push_back(x);
+	v.push_back(max);
+	return v;
+}
+
+}
+
+double StreamTuner::timeRun(BlockMapAFUBase& afu,const StreamTuning& t)
+{
+	afu.streamTuning(t);
+	afu.start();
+
+	const auto t0 = chrono::steady_clock::now();
+	afu.run();
+	const auto t1 = chrono::steady_clock::now();
+
+	const bool ok = afu.status() == BlockMapAFUBase::Done;
+	afu.terminate();
+
+	return ok ? chrono::duration<double>(t1-t0).count() : -1.0;
+}
+
+double StreamTuner::measure(const StreamTuning& t)
+{
+	double best=-1.0;
+	for(unsigned i=0;i<m_reps;++i)
+	{
+		const double s = m_workload(t);
+		if (s >= 0.0 && (best < 0.0 || s < best))
+			best = s;
+	}
+
+	if (best < 0.0)
+		BLUELINK_TRACE(TuneFailed,t.readTags,t.readBuffers,t.writeTags,t.writeBuffers);
+	else
+		BLUELINK_TRACE(TuneRun,t.readTags,t.readBuffers,t.writeTags,t.writeBuffers,uint64_t(best*1e9));
+
+	m_results.push_back(Result{ t, best });
+	return best;
+}
+
+StreamTuner::Result StreamTuner::tune(const StreamTuning& max)
+{
+	m_results.clear();
+
+	unsigned StreamTuning::* const fields[] = {
+		&StreamTuning::readTags, &StreamTuning::readBuffers, &StreamTuning::writeTags, &StreamTuning::writeBuffers };
+
+	Result best{ max, measure(max) };
+
+	for(unsigned pass=0; pass<m_maxPasses; ++pass)
+	{
+		bool improved=false;
+
+		for(const auto f : fields)
+			for(const unsigned v : candidates(max.*f))
+			{
+				if (v == best.tuning.*f)
+					continue;
+
+				StreamTuning t = best.tuning;
+				t.*f = v;
+
+				const double s = measure(t);
+				if (s >= 0.0 && (best.seconds < 0.0 || s < best.seconds))
+				{
+					best = Result{ t, s };
+					improved = true;
+				}
+			}
+
+		if (!improved)
+			break;
+	}
+	return best;
+}
+
+void StreamTuner::printResults(ostream& os) const
+{
+	const ios::fmtflags flags = os.flags();
+	const streamsize prec = os.precision();
+
+	os << "  read tags/bufs  write tags/bufs    time (ms)" << endl;
+	for(const Result& r : m_results)
+	{
+		os << setw(11) << r.tuning.readTags << '/' << left << setw(4) << r.tuning.readBuffers << right <<
+			setw(12) << r.tuning.writeTags << '/' << left << setw(4) << r.tuning.writeBuffers << right << ' ';
+		if (r.seconds < 0.0)
+			os << setw(12) << "failed" << endl;
+		else
+			os << setw(12) << fixed << setprecision(3) << r.seconds*1e3 << endl;
+	}
+
+	os.flags(flags);
+	os.precision(prec);
+}
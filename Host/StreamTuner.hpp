@@ -0,0 +1,63 @@
+/*
+ * StreamTuner.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef STREAMTUNER_HPP_
+#define STREAMTUNER_HPP_
+
+#include <BlueLink/Host/BlockMapAFUBase.hpp>
+
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+/** Finds the fastest stream tuning (BlockMapAFUBase::StreamTuning) for a workload by timing it under different settings.
+ *
+ * The workload runs one complete job with the tuning it's given and returns the time to minimize in seconds (negative if the job
+ * failed). timeRun() does that for a BlockMapAFUBase set up for a whole-block job, so a typical workload is
+ *
+ *     [&](const StreamTuning& t){ MyAFU afu(dev); afu.set(...); return StreamTuner::timeRun(afu,t); }
+ *
+ * Each of the four limits is swept in turn over the powers of two below its synthesized maximum and the maximum itself, keeping
+ * the others at the best found so far, and the passes repeat until one makes no improvement (coordinate descent: tens of runs
+ * rather than every combination). Each setting is timed reps times, keeping the fastest.
+ */
+
+class StreamTuner
+{
+public:
+	typedef BlockMapAFUBase::StreamTuning StreamTuning;
+	typedef std::function<double(const StreamTuning&)> Workload;
+
+	struct Result
+	{
+		StreamTuning	tuning;
+		double			seconds;			///< Fastest of the reps (negative if every rep failed)
+	};
+
+	explicit StreamTuner(Workload w) : m_workload(w){}
+
+	void		reps(unsigned n){ m_reps = n ? n : 1; }
+	void		maxPasses(unsigned n){ m_maxPasses = n ? n : 1; }
+
+	/// Sweep within the synthesized maxima (see BlockMapAFUBase::streamTuningMax) and return the fastest setting
+	Result		tune(const StreamTuning& max);
+
+	const std::vector<Result>&	results() const { return m_results; }		///< Every setting timed by the last tune(), in order
+	void		printResults(std::ostream& os) const;
+
+	/// Set the tuning, start and run the AFU, and return the run time (negative if it didn't finish); terminates the AFU
+	static double timeRun(BlockMapAFUBase& afu,const StreamTuning& t);
+
+private:
+	double		measure(const StreamTuning& t);
+
+	Workload			m_workload;
+	unsigned			m_reps=1;
+	unsigned			m_maxPasses=4;
+	std::vector<Result>	m_results;
+};
+
+#endif /* STREAMTUNER_HPP_ */
@@ -0,0 +1,168 @@
+/*
+ * TelemetrySampler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "TelemetrySampler.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+TelemetrySampler::TelemetrySampler(const BlockMapAFUBase& afu,const std::chrono::microseconds period,const std::size_t ringCapacity) :
+	m_afu(afu),
+	m_period_ns(chrono::nanoseconds(period).count()),
+	m_ring(ringCapacity)
+{
+}
+
+TelemetrySampler::~TelemetrySampler()
+{
+	stop();
+}
+
+void TelemetrySampler::start()
+{
+	if (m_thread.joinable())
+		return;
+
+	m_stop = false;
+	m_thread = thread(&TelemetrySampler::run,this);
+}
+
+void TelemetrySampler::stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+	m_thread.join();
+}
+
+TelemetrySampler::Metrics TelemetrySampler::metrics() const
+{
+	lock_guard<mutex> L(m_mutex);
+	return m_metrics;
+}
+
+std::size_t TelemetrySampler::drain(Sample* out,const std::size_t max)
+{
+	std::size_t n=0;
+	while(n < max && m_ring.pop(out[n]))
+		++n;
+	return n;
+}
+
+void TelemetrySampler::run()
+{
+	clock::time_point next = clock::now();
+
+	for(;;)
+	{
+		Sample s;
+		uint64_t regs[4];					// MMIO 0x20-0x38: output size, output transferred, input size, input transferred
+
+		s.t = clock::now();
+		m_afu.mmio_read_block(0x20,4,regs);
+		s.status = m_afu.status();
+		s.oSize = regs[0];
+		s.oBytes = regs[1];
+		s.iSize = regs[2];
+		s.iBytes = regs[3];
+
+		const bool stored = m_ring.push(s);
+
+		Metrics m;
+		bool notify;
+		{
+			lock_guard<mutex> L(m_mutex);
+			m_metrics.dropped += !stored;
+			update(s);
+			m = m_metrics;
+			notify = m_callback && m.samples % m_callbackEvery == 0;
+		}
+
+		if (notify)
+			m_callback(m);
+
+		// fixed rate; if sampling fell behind (eg. slow callback), carry on from now rather than bursting to catch up
+		next += chrono::nanoseconds(m_period_ns.load());
+		if (next < clock::now())
+			next = clock::now();
+
+		unique_lock<mutex> L(m_mutex);
+		if (m_cv.wait_until(L,next,[this]{ return m_stop; }))
+			break;
+	}
+}
+
+void TelemetrySampler::update(const Sample& s)
+{
+	Metrics& m = m_metrics;
+	++m.samples;
+
+	// first sample, or the counters went backwards because a new job started: restart the job's metrics
+	if (m_first || s.iBytes < m.last.iBytes || s.oBytes < m.last.oBytes)
+	{
+		const uint64_t samples = m.samples, dropped = m.dropped;
+		m = Metrics();
+		m.samples = samples;
+		m.dropped = dropped;
+		m.last = s;
+		m_base = s;
+		m_first = false;
+		return;
+	}
+
+	const chrono::nanoseconds dt = chrono::duration_cast<chrono::nanoseconds>(s.t-m.last.t);
+	const uint64_t di = s.iBytes-m.last.iBytes, dout = s.oBytes-m.last.oBytes;
+
+	m.readGBps = dt.count() ? double(di)/double(dt.count()) : 0.0;			// bytes/ns = GB/s
+	m.writeGBps = dt.count() ? double(dout)/double(dt.count()) : 0.0;
+
+	// averaging window starts at the last sample before any data moved
+	if (m_base.iBytes == s.iBytes && m_base.oBytes == s.oBytes && m_base.iBytes == 0 && m_base.oBytes == 0)
+		m_base = s;
+
+	// and ends at the last one where it did, so the averages hold once the job finishes
+	const chrono::nanoseconds dtAvg = chrono::duration_cast<chrono::nanoseconds>(s.t-m_base.t);
+	if ((di || dout) && dtAvg.count())
+	{
+		m.avgReadGBps = double(s.iBytes-m_base.iBytes)/double(dtAvg.count());
+		m.avgWriteGBps = double(s.oBytes-m_base.oBytes)/double(dtAvg.count());
+	}
+
+	if (s.status == BlockMapAFUBase::Running && di == 0 && dout == 0)
+	{
+		if (!m.stalled)
+			++m.stalls;
+		m.stalled = true;
+		m.currentStall += dt;
+		m.stallTime += dt;
+		m.longestStall = std::max(m.longestStall,m.currentStall);
+	}
+	else
+	{
+		m.stalled = false;
+		m.currentStall = chrono::nanoseconds(0);
+	}
+
+	m.last = s;
+}
+
+void TelemetrySampler::printMetrics(std::ostream& os) const
+{
+	const Metrics m = metrics();
+
+	os << fixed << setprecision(3) << "status " << m.last.status << "  input " << m.last.iBytes << '/' << m.last.iSize << "  output " <<
+		m.last.oBytes << '/' << m.last.oSize << "  read " << m.readGBps << " GB/s (avg " << m.avgReadGBps << ")  write " <<
+		m.writeGBps << " GB/s (avg " << m.avgWriteGBps << ")  stalls " << m.stalls << " (" << m.stallTime.count()*1e-6 << " ms, longest " <<
+		m.longestStall.count()*1e-6 << " ms)" << (m.stalled ? " STALLED" : "") << "  samples " << m.samples << " (" << m.dropped <<
+		" dropped)" << endl;
+}
@@ -0,0 +1,114 @@
+/*
+ * TelemetrySampler.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TELEMETRYSAMPLER_HPP_
+#define TELEMETRYSAMPLER_HPP_
+
+#include <BlueLink/Host/BlockMapAFUBase.hpp>
+#include <BlueLink/Host/SPSCRing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+
+/** Background sampler of a mkBlockMapAFU's progress registers, for watching throughput live.
+ *
+ * A thread reads status and the size/transferred registers (MMIO 0x00, 0x20-0x38) every period. It only reads, so it can run
+ * alongside the thread controlling the AFU. Raw samples go into a lock-free SPSC ring for one consumer to drain (dropped and
+ * counted if the consumer falls behind); each sample also updates the metrics, which can be polled or pushed to a callback.
+ *
+ * Metrics: instantaneous read/write GB/s over the last period, averages over the time the job has been moving data, and stalls
+ * (consecutive samples while Running in which neither stream advanced) with their count, total and longest duration. The
+ * transfer counters going backwards means a new job started, so the averages and stall counts restart.
+ */
+
+class TelemetrySampler
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	struct Sample
+	{
+		clock::time_point			t;
+		BlockMapAFUBase::Status		status=BlockMapAFUBase::Resetting;
+		uint64_t					iSize=0;
+		uint64_t					iBytes=0;			///< Input bytes transferred
+		uint64_t					oSize=0;
+		uint64_t					oBytes=0;			///< Output bytes transferred
+	};
+
+	struct Metrics
+	{
+		Sample						last;
+
+		double						readGBps=0.0;		///< Over the last sample period
+		double						writeGBps=0.0;
+		double						avgReadGBps=0.0;	///< From the job's first to its latest progress
+		double						avgWriteGBps=0.0;
+
+		bool						stalled=false;		///< Running but no progress since the previous sample
+		std::chrono::nanoseconds	currentStall{0};	///< Length of the stall in progress (0 if not stalled)
+		unsigned					stalls=0;			///< Stall intervals (including the current one)
+		std::chrono::nanoseconds	stallTime{0};		///< Total, including the current one
+		std::chrono::nanoseconds	longestStall{0};
+
+		uint64_t					samples=0;			///< Taken since the sampler started
+		uint64_t					dropped=0;			///< Not stored because the ring was full
+	};
+
+	typedef std::function<void(const Metrics&)> Callback;
+
+	explicit TelemetrySampler(const BlockMapAFUBase& afu,std::chrono::microseconds period=std::chrono::microseconds(1000),
+		std::size_t ringCapacity=4096);
+	~TelemetrySampler();
+
+	TelemetrySampler(const TelemetrySampler&) = delete;
+	TelemetrySampler& operator=(const TelemetrySampler&) = delete;
+
+	void		start();				///< Start the sampling thread (no-op if running)
+	void		stop();					///< Stop it and wait for it to finish
+	bool		running() const { return m_thread.joinable(); }
+
+	void		period(std::chrono::microseconds p){ m_period_ns = std::chrono::nanoseconds(p).count(); }
+
+	/// Called on the sampling thread after every n-th sample (set before start(), or while stopped)
+	void		callback(Callback f,unsigned n=1){ m_callback=f; m_callbackEvery=std::max(n,1U); }
+
+	Metrics		metrics() const;		///< Latest metrics (from any thread)
+
+	/// Consumer only: move up to max of the oldest samples to out, returning how many
+	std::size_t	drain(Sample* out,std::size_t max);
+
+	void		printMetrics(std::ostream& os) const;
+
+private:
+	void		run();
+	void		update(const Sample& s);
+
+	const BlockMapAFUBase&			m_afu;
+	std::atomic<int64_t>			m_period_ns;
+
+	SPSCRing<Sample>				m_ring;
+
+	Callback						m_callback;
+	unsigned						m_callbackEvery=1;
+
+	mutable std::mutex				m_mutex;			// metrics, and stopping the thread
+	std::condition_variable			m_cv;
+	bool							m_stop=false;
+	std::thread						m_thread;
+
+	Metrics							m_metrics;
+	bool							m_first=true;		// no previous sample
+	Sample							m_base;				// start of the averaging window
+};
+
+#endif /* TELEMETRYSAMPLER_HPP_ */
@@ -0,0 +1,251 @@
+/*
+ * Trace.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const Trace::EventInfo eventTable[] = {
+#define BLUELINK_TRACE_INFO(name,level,fmt) { #name, Trace::level, fmt },
+	BLUELINK_TRACE_EVENTS(BLUELINK_TRACE_INFO)
+#undef BLUELINK_TRACE_INFO
+};
+
+static_assert(sizeof(eventTable)/sizeof(eventTable[0]) == Trace::NEvents,"Trace event table mismatch");
+static_assert(sizeof(Trace::Record) == 64,"Trace record should fill one cache line");
+
+uint64_t now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return uint64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
+
+Trace::Level envLevel(const char* var,Trace::Level def)
+{
+	const char* s = getenv(var);
+	return s && *s ? Trace::Level(min(atoi(s),int(Trace::Debug))) : def;
+}
+
+// One thread's ring. The owning thread is the only writer; dump() copies it and keeps only records that weren't overwritten
+// while it was copying (the head is read before and after). Released rings keep their records and are reused by new threads.
+struct Ring
+{
+	explicit Ring(size_t n) : records(n){}
+
+	vector<Trace::Record>	records;			// power-of-two size
+	atomic<uint64_t>		head{0};			// records ever written
+	bool					inUse=true;
+};
+
+mutex					ringsMutex;				// ring list and free list
+vector<unique_ptr<Ring>>	rings;
+size_t					ringRecords=4096;
+
+Ring* acquireRing()
+{
+	lock_guard<mutex> L(ringsMutex);
+	for(const auto& r : rings)
+		if (!r->inUse && r->records.size() == ringRecords)
+		{
+			r->inUse = true;
+			return r.get();
+		}
+	rings.emplace_back(new Ring(ringRecords));
+	return rings.back().get();
+}
+
+// Per-thread handle, returning the ring to the free list when the thread exits
+struct ThreadRing
+{
+	~ThreadRing()
+	{
+		if (ring)
+		{
+			lock_guard<mutex> L(ringsMutex);
+			ring->inUse = false;
+		}
+	}
+
+	Ring*		ring=nullptr;
+	uint32_t	tid=0;
+};
+
+thread_local ThreadRing threadRing;
+
+mutex					consoleMutex;
+
+void dumpAtExit()
+{
+	if (const char* fn = getenv("BLUELINK_TRACE_FILE"))
+		Trace::dump(string(fn));
+}
+
+}
+
+constexpr const char* Trace::fileMagic;
+
+atomic<uint8_t> Trace::s_level{envLevel("BLUELINK_TRACE",Trace::Info)};
+atomic<uint8_t> Trace::s_consoleLevel{envLevel("BLUELINK_TRACE_CONSOLE",Trace::Warning)};
+
+namespace {
+const int registerDump = getenv("BLUELINK_TRACE_FILE") ? atexit(dumpAtExit) : 0;
+}
+
+const Trace::EventInfo& Trace::info(Event e)
+{
+	return eventTable[e];
+}
+
+const char* Trace::levelName(Level l)
+{
+	static const char* const names[] = { "OFF", "ERROR", "WARNING", "INFO", "DEBUG" };
+	return names[min(unsigned(l),unsigned(Debug))];
+}
+
+void Trace::bufferRecords(size_t n)
+{
+	size_t c=1;
+	while(c < n)
+		c <<= 1;
+
+	lock_guard<mutex> L(ringsMutex);
+	ringRecords = c;
+}
+
+void Trace::record(const Event e,const uint64_t* args,const unsigned nArgs)
+{
+	ThreadRing& tr = threadRing;
+	if (!tr.ring)
+	{
+		tr.ring = acquireRing();
+		tr.tid = syscall(SYS_gettid);
+	}
+
+	Ring& r = *tr.ring;
+	const uint64_t h = r.head.load(memory_order_relaxed);
+
+	Record& rec = r.records[h & (r.records.size()-1)];
+	rec.t_ns = now_ns();
+	rec.tid = tr.tid;
+	rec.event = e;
+	rec.level = eventTable[e].level;
+	rec.nArgs = nArgs;
+	copy(args,args+nArgs,rec.args);
+	fill(rec.args+nArgs,rec.args+MaxArgs,0);
+
+	r.head.store(h+1,memory_order_release);
+
+	if (eventTable[e].level <= consoleLevel())
+	{
+		const string s = format(eventTable[e].format,args,nArgs);
+		lock_guard<mutex> L(consoleMutex);
+		cerr << (eventTable[e].level <= Warning ? string(levelName(eventTable[e].level)) + ": " : string()) << s << endl;
+	}
+}
+
+string Trace::format(const char* fmt,const uint64_t* args,const unsigned nArgs)
+{
+	ostringstream os;
+	unsigned i=0;
+
+	for(const char* p=fmt; *p; ++p)
+	{
+		const char* close = *p == '{' ? strchr(p,'}') : nullptr;
+		if (!close || close-p > 2)
+		{
+			os << *p;
+			continue;
+		}
+
+		const char spec = close-p == 2 ? p[1] : 0;
+		const uint64_t v = i < nArgs ? args[i] : 0;
+		++i;
+
+		if (spec == 'x')
+			os << "0x" << hex << v << dec;
+		else if (spec == 'e')
+			os << strerror(int(v));
+		else
+			os << v;
+		p = close;
+	}
+	return os.str();
+}
+
+void Trace::dump(ostream& os)
+{
+	vector<Record> all;
+	{
+		lock_guard<mutex> L(ringsMutex);
+		for(const auto& r : rings)
+		{
+			const uint64_t n = r->records.size();
+			const uint64_t h0 = r->head.load(memory_order_acquire);
+			const vector<Record> copied(r->records);
+			const uint64_t h1 = r->head.load(memory_order_acquire);
+
+			// slots written after h0 may be torn; those below h1-n were overwritten during the copy
+			for(uint64_t i = h1 > n ? h1-n : 0; i < h0; ++i)
+				all.push_back(copied[i & (n-1)]);
+		}
+	}
+
+	stable_sort(all.begin(),all.end(),[](const Record& a,const Record& b){ return a.t_ns < b.t_ns; });
+
+	// header: magic, record size, event table (id order), record count
+	auto writeU32 = [&os](uint32_t x){ os.write(reinterpret_cast<const char*>(&x),4); };
+	auto writeString = [&](const char* s){ writeU32(strlen(s)); os.write(s,strlen(s)); };
+
+	os.write(fileMagic,8);
+	writeU32(sizeof(Record));
+	writeU32(NEvents);
+	for(const EventInfo& e : eventTable)
+	{
+		writeString(e.name);
+		writeU32(e.level);
+		writeString(e.format);
+	}
+
+	const uint64_t n = all.size();
+	os.write(reinterpret_cast<const char*>(&n),8);
+	os.write(reinterpret_cast<const char*>(all.data()),all.size()*sizeof(Record));
+}
+
+bool Trace::dump(const string& fn)
+{
+	ofstream os(fn.c_str(),ios_base::binary);
+	if (!os)
+	{
+		cerr << "ERROR: Trace failed to open " << fn << " for writing" << endl;
+		return false;
+	}
+	dump(os);
+	return bool(os);
+}
+
+void Trace::clear()
+{
+	lock_guard<mutex> L(ringsMutex);
+	for(const auto& r : rings)
+		r->head.store(0,memory_order_release);
+}
@@ -0,0 +1,175 @@
+/*
+ * Trace.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TRACE_HPP_
+#define TRACE_HPP_
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+
+/** Levelled binary event tracing for the host library, in place of printing to cout.
+ *
+ * Each event is a fixed-size record (time, thread, event id, up to six integer arguments) appended to a per-thread ring that
+ * overwrites its oldest records, so the last few thousand events per thread are always available to dump() after a failure.
+ * Nothing is formatted on the hot path: the text for each event lives in the table below and is only applied by the console
+ * sink (events at or above its level, by default warnings and errors, to cerr) or by the decoder (bluelink_tracedecode) on a
+ * dumped file.
+ *
+ * Events above BLUELINK_TRACE_LEVEL are compiled out entirely; the default keeps Info and below, leaving the per-access MMIO
+ * events (Debug) out of the build unless it's defined to 4. The rest cost a relaxed load and a branch when disabled at runtime
+ * with level(). Environment variables set the initial state:
+ *
+ *   BLUELINK_TRACE=<0-4>			runtime level recorded (default 3, Info)
+ *   BLUELINK_TRACE_CONSOLE=<0-4>	level printed to cerr (default 2, Warning)
+ *   BLUELINK_TRACE_FILE=<path>		dump() there at exit
+ *
+ * Format placeholders: {} decimal, {x} hex, {e} strerror of the argument.
+ */
+
+#ifndef BLUELINK_TRACE_LEVEL
+#define BLUELINK_TRACE_LEVEL 3
+#endif
+
+//	X(Name,					Level,		Format)
+#define BLUELINK_TRACE_EVENTS(X) \
+	X(Attach,				Info,		"AFU started with WED {x}") \
+	X(AttachEmulated,		Info,		"AFU started with WED {x} on emulator") \
+	X(AttachFailed,			Error,		"cxl_afu_attach failed with error code {}: {e}") \
+	X(MMIOMapped,			Info,		"MMIO mapped ({x} bytes)") \
+	X(MMIOMapFailed,		Error,		"cxl_mmio_map failed with error code {}: {e}") \
+	X(MMIORead,				Debug,		"MMIO read {x} -> {x}") \
+	X(MMIOWrite,			Debug,		"MMIO write {x} <- {x}") \
+	X(MMIOReadFailed,		Error,		"cxl_mmio_read{} at {x} returned {}: {e}") \
+	X(MMIOWriteFailed,		Error,		"cxl_mmio_write{} at {x} returned {}: {e}") \
+	X(EventPollFailed,		Error,		"poll on AFU event fd failed: {e}") \
+	X(EventReadFailed,		Error,		"Unexpected return from cxl_read_event: {}") \
+	X(Interrupt,			Debug,		"AFU interrupt {}") \
+	X(DataStorageFault,		Error,		"AFU data storage fault at address {x}") \
+	X(AFUError,				Error,		"AFU error code {x}") \
+	X(Status,				Info,		"AFU status {x} -> {x}") \
+	X(Run,					Info,		"Starting") \
+	X(Terminate,			Info,		"Terminating") \
+	X(StartTimeout,			Error,		"Timeout waiting for 'waiting' status (st={x})") \
+	X(ReadyTimeout,			Error,		"Timeout while waiting for Waiting status (st={x})") \
+	X(RunTimeout,			Error,		"Timeout waiting for done status; status {x} input: {}/{}  output: {}/{}") \
+	X(JobError,				Error,		"AFU raised its job error interrupt") \
+	X(HybridFallback,		Warning,	"AFU part of hybrid job failed; mapping its {} elements on the CPU") \
+	X(ShardTimeout,			Error,		"Timeout waiting for done status on sharded job") \
+	X(FillTimeout,			Error,		"Timeout waiting for fill {}") \
+	X(ChunkTimeout,			Error,		"Timeout waiting for chunk {} (input {} output {} bytes so far)") \
+	X(DispatcherTimeout,	Error,		"AFUDispatcher timeout after {} jobs (input {} output {} bytes); failing all jobs") \
+	X(DispatcherShutdown,	Error,		"AFUDispatcher timeout waiting for Done status at shutdown") \
+	X(MemcpyTimeout,		Error,		"AFUMemcpy timeout after {} chunks and {} fills (input {} output {} bytes); falling back to the CPU") \
+	X(MemcpyShutdown,		Error,		"AFUMemcpy timeout waiting for Done status at shutdown") \
+	X(CheckStart,			Info,		"Checking output ({} elements, bit-exact {})") \
+	X(CheckSerial,			Info,		"  Checker has no merge(), checking on one thread instead of {}") \
+	X(CheckMismatch,		Warning,	"  (at sample {})") \
+	X(CheckTruncated,		Warning,	" ... and {} more errors truncated") \
+	X(CheckPassed,			Info,		"  Errors: 0/{}") \
+	X(CheckFailed,			Error,		"  Errors: {}/{}") \
+	X(TuneRun,				Info,		"Stream tuning read {}/{} write {}/{} (tags/buffers): {} ns") \
+	X(TuneFailed,			Warning,	"Stream tuning read {}/{} write {}/{} (tags/buffers): job failed") \
+	X(MbindFailed,			Warning,	"pinned_alloc: mbind to NUMA node {} failed: {e}") \
+	X(HugeTLBFailed,		Warning,	"pinned_alloc: hugetlb mapping of {} bytes failed ({e}), falling back to transparent huge pages") \
+	X(MlockFailed,			Warning,	"pinned_alloc: mlock of {} bytes failed ({e}); buffers may be swapped or migrated (raise ulimit -l)") \
+	X(MlockRequired,		Error,		"pinned_alloc: mlock of {} bytes failed ({e}); allocation fails") \
+	X(MappedSyncFailed,		Warning,	"MappedFile: msync of fd {} failed: {e}") \
+	X(MappedTruncateFailed,	Warning,	"MappedFile: truncating fd {} to {} bytes failed: {e}") \
+	X(MemcpyUnavailable,	Warning,	"AFUMemcpy unavailable, using the CPU (cause in the preceding events)") \
+	X(ProfilerOpenFailed,	Error,		"Profiler failed to open its trace file for writing: {e}") \
+	X(EmuChunkOverflow,		Error,		"BlockMapEmulator: chunk queue overflow, chunk dropped") \
+	X(EmuFillOverflow,		Error,		"BlockMapEmulator: fill queue overflow, fill dropped") \
+	X(ContextsLeased,		Warning,	"AFUContextPool destroyed with {} contexts still leased")
+
+class Trace
+{
+public:
+	enum Level : uint8_t { Off=0, Error=1, Warning=2, Info=3, Debug=4 };
+
+#define BLUELINK_TRACE_ENUM(name,level,fmt) name,
+	enum Event : uint16_t { BLUELINK_TRACE_EVENTS(BLUELINK_TRACE_ENUM) NEvents };
+#undef BLUELINK_TRACE_ENUM
+
+	static const unsigned MaxArgs=6;
+
+	struct Record								///< One event (64 bytes); this is also the layout in dumped files
+	{
+		uint64_t	t_ns;						///< CLOCK_MONOTONIC
+		uint32_t	tid;						///< Linux thread id
+		uint16_t	event;
+		uint8_t		level;
+		uint8_t		nArgs;
+		uint64_t	args[MaxArgs];
+	};
+
+	struct EventInfo
+	{
+		const char*	name;
+		Level		level;
+		const char*	format;
+	};
+
+	static const EventInfo& info(Event e);
+	static const char*		levelName(Level l);
+
+	/// Compile-time level of an event, so the macro below can drop it
+	static constexpr Level	levelOf(Event e)
+	{
+#define BLUELINK_TRACE_LEVELOF(name,level,fmt) e == name ? level :
+		return BLUELINK_TRACE_EVENTS(BLUELINK_TRACE_LEVELOF) Off;
+#undef BLUELINK_TRACE_LEVELOF
+	}
+
+	static bool				enabled(Level l){ return l <= s_level.load(std::memory_order_relaxed); }
+
+	static void				level(Level l){ s_level.store(l,std::memory_order_relaxed); }
+	static Level			level(){ return Level(s_level.load(std::memory_order_relaxed)); }
+	static void				consoleLevel(Level l){ s_consoleLevel.store(l,std::memory_order_relaxed); }
+	static Level			consoleLevel(){ return Level(s_consoleLevel.load(std::memory_order_relaxed)); }
+
+	/// Records per thread ring (rounded up to a power of two); applies to threads that haven't traced yet
+	static void				bufferRecords(std::size_t n);
+
+	template<typename... Args>static void emit(Event e,Args... a)
+	{
+		static_assert(sizeof...(Args) <= MaxArgs,"Too many trace arguments");
+		const uint64_t v[] = { arg(a)..., 0 };
+		record(e,v,sizeof...(Args));
+	}
+
+	/// Substitute args into a format string
+	static std::string		format(const char* fmt,const uint64_t* args,unsigned nArgs);
+
+	/// Write every thread's retained records, oldest first, with the event table so the file decodes without this build
+	static void				dump(std::ostream& os);
+	static bool				dump(const std::string& fn);		///< False if the file can't be written
+
+	static void				clear();							///< Discard retained records (not thread-safe against emitters)
+
+	static constexpr const char* fileMagic="BLTRACE1";
+
+private:
+	template<typename T>static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value,uint64_t>::type arg(T x)
+		{ return uint64_t(x); }
+	template<typename T>static uint64_t arg(T* p){ return reinterpret_cast<uintptr_t>(p); }
+
+	static void				record(Event e,const uint64_t* args,unsigned nArgs);
+
+	static std::atomic<uint8_t>	s_level;
+	static std::atomic<uint8_t>	s_consoleLevel;
+};
+
+/// Emit a trace event (arguments are only evaluated if it's enabled)
+#define BLUELINK_TRACE(ev,...) do { \
+		if (Trace::levelOf(Trace::ev) <= BLUELINK_TRACE_LEVEL && Trace::enabled(Trace::levelOf(Trace::ev))) \
+			Trace::emit(Trace::ev,##__VA_ARGS__); \
+	} while(0)
+
+#endif /* TRACE_HPP_ */
@@ -0,0 +1,141 @@
+/*
+ * TraceDecode.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *
+ * Prints a binary trace written by Trace::dump (eg. via BLUELINK_TRACE_FILE) as text, one event per line:
+ *
+ *     <seconds since first event> [<tid>] <LEVEL> <Event>: <formatted message>
+ *
+ * The event table is read from the file itself, so traces from other builds decode correctly.
+ *
+ * Usage: bluelink_tracedecode <file> [key=value]...
+ *      level=<0-4>         most verbose level to print (default 4, everything)
+ *      tid=<n>             only this thread
+ *      event=<Name>        only this event
+ */
+
+#include <BlueLink/Host/Trace.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct FileEvent
+{
+	string		name;
+	unsigned	level;
+	string		format;
+};
+
+bool readU32(istream& is,uint32_t& x)
+{
+	return bool(is.read(reinterpret_cast<char*>(&x),4));
+}
+
+bool readString(istream& is,string& s)
+{
+	uint32_t n;
+	if (!readU32(is,n) || n > 4096)
+		return false;
+	s.resize(n);
+	return n == 0 || bool(is.read(&s[0],n));
+}
+
+}
+
+int main(int argc,char **argv)
+{
+	if (argc < 2)
+	{
+		cout << "Usage: " << argv[0] << " <file> [level=<0-4>] [tid=<n>] [event=<Name>]" << endl;
+		return 1;
+	}
+
+	unsigned maxLevel = Trace::Debug;
+	long tid = -1;
+	string eventName;
+
+	for(int i=2;i<argc;++i)
+	{
+		const string a(argv[i]);
+		const size_t eq = a.find('=');
+		const string k = a.substr(0,eq), v = eq == string::npos ? "" : a.substr(eq+1);
+
+		if (k == "level")
+			maxLevel = strtoul(v.c_str(),nullptr,10);
+		else if (k == "tid")
+			tid = strtol(v.c_str(),nullptr,10);
+		else if (k == "event")
+			eventName = v;
+		else
+		{
+			cout << "ERROR: Unrecognized option " << a << endl;
+			return 1;
+		}
+	}
+
+	ifstream is(argv[1],ios_base::binary);
+	if (!is)
+	{
+		cout << "ERROR: Failed to open " << argv[1] << endl;
+		return 1;
+	}
+
+	char magic[8];
+	uint32_t recordBytes,nEvents;
+	if (!is.read(magic,8) || memcmp(magic,Trace::fileMagic,8) || !readU32(is,recordBytes) || !readU32(is,nEvents))
+	{
+		cout << "ERROR: " << argv[1] << " is not a BlueLink trace" << endl;
+		return 1;
+	}
+	if (recordBytes != sizeof(Trace::Record))
+	{
+		cout << "ERROR: Unsupported record size " << recordBytes << endl;
+		return 1;
+	}
+
+	vector<FileEvent> events(nEvents);
+	for(FileEvent& e : events)
+		if (!readString(is,e.name) || !readU32(is,e.level) || !readString(is,e.format))
+		{
+			cout << "ERROR: Truncated event table" << endl;
+			return 1;
+		}
+
+	uint64_t n;
+	if (!is.read(reinterpret_cast<char*>(&n),8))
+	{
+		cout << "ERROR: Truncated header" << endl;
+		return 1;
+	}
+
+	uint64_t t0=0;
+	Trace::Record r;
+	for(uint64_t i=0; i<n && is.read(reinterpret_cast<char*>(&r),sizeof(r)); ++i)
+	{
+		if (i == 0)
+			t0 = r.t_ns;
+
+		const bool known = r.event < events.size();
+		const string name = known ? events[r.event].name : "Event" + to_string(r.event);
+
+		if (r.level > maxLevel || (tid >= 0 && r.tid != tid) || (!eventName.empty() && name != eventName))
+			continue;
+
+		cout << fixed << setprecision(9) << setw(14) << (r.t_ns-t0)*1e-9 << " [" << r.tid << "] " <<
+			setw(7) << left << Trace::levelName(Trace::Level(r.level)) << right << ' ' << name << ": " <<
+			(known ? Trace::format(events[r.event].format.c_str(),r.args,min<unsigned>(r.nArgs,Trace::MaxArgs)) : string()) << endl;
+	}
+
+	if (!is)
+		cout << "WARNING: Trace truncated" << endl;
+}
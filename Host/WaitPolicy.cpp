@@ -0,0 +1,77 @@
+/*
+ * WaitPolicy.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "WaitPolicy.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+void LatencyHistogram::record(const std::chrono::nanoseconds t)
+{
+	const uint64_t ns = max<int64_t>(t.count(),1);
+
+	++m_bucket[63-__builtin_clzll(ns)];
+	++m_count;
+	m_sum_ns += ns;
+}
+
+void LatencyHistogram::clear()
+{
+	m_bucket.fill(0);
+	m_count=0;
+	m_sum_ns=0;
+}
+
+uint64_t LatencyHistogram::quantile_ns(const double q) const
+{
+	const uint64_t target = q*m_count;
+	uint64_t n=0;
+
+	for(unsigned i=0;i<m_bucket.size();++i)
+		if ((n += m_bucket[i]) > target)
+			return i < 63 ? 2ULL << i : ~0ULL;
+	return 0;
+}
+
+void LatencyHistogram::print(std::ostream& os) const
+{
+	os << "  Samples: " << m_count << " mean " << fixed << setprecision(1) << mean_ns()*1e-3 << " us  p50 < " <<
+		quantile_ns(0.5)*1e-3 << " us  p99 < " << quantile_ns(0.99)*1e-3 << " us" << endl;
+
+	for(unsigned i=0;i<m_bucket.size();++i)
+		if (m_bucket[i])
+			os << "    [" << setw(12) << (1ULL<<i) << ',' << setw(12) << (2ULL<<i) << ") ns  " << setw(10) << m_bucket[i] << endl;
+}
+
+
+
+void WaitPolicy::finish(const clock::time_point t0,const bool ok)
+{
+	++m_waits;
+	if (ok)
+		m_latency.record(clock::now()-t0);
+	else if (!m_failed)
+		++m_timeouts;
+}
+
+void WaitPolicy::resetStats()
+{
+	m_latency.clear();
+	m_polls=0;
+	m_waits=0;
+	m_timeouts=0;
+}
+
+void WaitPolicy::printStats(std::ostream& os) const
+{
+	static const char* modeNames[] = { "spin", "spin-yield", "backoff", "event" };
+
+	os << "Wait policy " << modeNames[m_mode] << ": " << m_waits << " waits (" << m_timeouts << " timed out), " << m_polls <<
+		" polls" << endl;
+	m_latency.print(os);
+}
@@ -0,0 +1,144 @@
+/*
+ * WaitPolicy.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef WAITPOLICY_HPP_
+#define WAITPOLICY_HPP_
+
+#include "AFU.hpp"
+
+#include <array>
+#include <chrono>
+#include <iosfwd>
+#include <thread>
+
+/** Histogram of durations in power-of-two nanosecond buckets (bucket i holds [2^i,2^(i+1)) ns) */
+
+class LatencyHistogram
+{
+public:
+	void 		record(std::chrono::nanoseconds t);
+	void 		clear();
+
+	uint64_t	count() const { return m_count; }
+	double		mean_ns() const { return m_count ? double(m_sum_ns)/double(m_count) : 0.0; }
+
+	/// Upper bound of the bucket containing quantile q (0..1), in ns
+	uint64_t	quantile_ns(double q) const;
+
+	void		print(std::ostream& os) const;
+
+private:
+	std::array<uint64_t,64>	m_bucket{};
+	uint64_t				m_count=0;
+	uint64_t				m_sum_ns=0;
+};
+
+
+
+/** How to wait for a condition on the AFU (usually a status register value).
+ *
+ * Spin         poll continuously (lowest latency, burns a core)
+ * SpinYield    poll spinPolls times, then yield the CPU between polls
+ * Backoff      poll spinPolls times, then sleep between polls, doubling from minSleep up to maxSleep
+ * Event        block on the AFU's interrupt (if one is given to until()) and check the condition when it arrives; otherwise
+ *              as Backoff. If a fail interrupt is given too (eg. the job error interrupt), its arrival ends the wait at once.
+ *
+ * Every wait counts its polls; until() records the time from call to condition true in a histogram.
+ */
+
+class WaitPolicy
+{
+public:
+	enum Mode { Spin, SpinYield, Backoff, Event };
+
+	explicit WaitPolicy(Mode m=Backoff) : m_mode(m){}
+
+	void mode(Mode m){ m_mode=m; }
+	Mode mode() const { return m_mode; }
+
+	void spinPolls(unsigned n){ m_spinPolls=n; }
+	void backoff(std::chrono::microseconds minSleep,std::chrono::microseconds maxSleep){ m_minSleep=minSleep; m_maxSleep=maxSleep; }
+
+	/// Wait until done() returns true or timeout elapses (returns false). In Event mode, waits for interrupt irq from events, and
+	/// returns false as soon as failIrq arrives instead (see failed()).
+	template<class Pred>bool until(Pred done,std::chrono::microseconds timeout,const AFU* events=nullptr,unsigned irq=0,
+		unsigned failIrq=0);
+
+	/// True if the last until() ended on its fail interrupt rather than by timing out
+	bool					failed()	const { return m_failed; }
+
+	const LatencyHistogram&	latency() const { return m_latency; }
+	uint64_t				polls() 	const { return m_polls; }
+	uint64_t				waits() 	const { return m_waits; }
+	uint64_t				timeouts() 	const { return m_timeouts; }
+
+	void					resetStats();
+	void					printStats(std::ostream& os) const;
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	void					finish(clock::time_point t0,bool ok);
+
+	Mode						m_mode=Backoff;
+	unsigned					m_spinPolls=100;
+	std::chrono::microseconds	m_minSleep=std::chrono::microseconds(1);
+	std::chrono::microseconds	m_maxSleep=std::chrono::microseconds(1000);
+
+	LatencyHistogram			m_latency;
+	uint64_t					m_polls=0;
+	uint64_t					m_waits=0;
+	uint64_t					m_timeouts=0;
+	bool						m_failed=false;
+};
+
+template<class Pred>bool WaitPolicy::until(Pred done,const std::chrono::microseconds timeout,const AFU* events,const unsigned irq,
+	const unsigned failIrq)
+{
+	const clock::time_point t0 = clock::now(), deadline = t0+timeout;
+	std::chrono::microseconds sleep = m_minSleep;
+	m_failed = false;
+
+	for(unsigned i=0; ; ++i)
+	{
+		++m_polls;
+		if (done())
+		{
+			finish(t0,true);
+			return true;
+		}
+
+		const clock::time_point now = clock::now();
+		if (now >= deadline)
+		{
+			finish(t0,false);
+			return false;
+		}
+
+		if (m_mode == Event && events && irq)
+		{
+			const unsigned got = events->await_interrupts(1u << irq | (failIrq ? 1u << failIrq : 0),
+				std::chrono::duration_cast<std::chrono::milliseconds>(deadline-now).count()+1);
+			if (failIrq && got == failIrq)
+			{
+				m_failed = true;
+				finish(t0,false);
+				return false;
+			}
+		}
+		else if (i < m_spinPolls || m_mode == Spin)
+			continue;
+		else if (m_mode == SpinYield)
+			std::this_thread::yield();
+		else
+		{
+			std::this_thread::sleep_for(std::min<clock::duration>(sleep,deadline-now));
+			sleep = std::min(2*sleep,m_maxSleep);
+		}
+	}
+}
+
+#endif /* WAITPOLICY_HPP_ */
@@ -0,0 +1,192 @@
+/*
+ * pinned_allocator.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "pinned_allocator.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+using namespace std;
+
+namespace {
+
+const std::size_t THPBytes=std::size_t(2)<<20;
+
+const int MPOL_BIND_=2;				// from <numaif.h>; using the syscall directly avoids a libnuma dependency
+
+std::size_t roundUp(std::size_t x,std::size_t m){ return (x+m-1)/m*m; }
+
+std::atomic<unsigned long> lockFailures{0};
+
+/// Anonymous mapping aligned to align (mapped oversize, then the excess is trimmed)
+void* mapAligned(std::size_t bytes,std::size_t align)
+{
+	void* p = mmap(nullptr,bytes+align,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if (p == MAP_FAILED)
+		throw std::bad_alloc();
+
+	uintptr_t base = reinterpret_cast<uintptr_t>(p);
+	uintptr_t aligned = roundUp(base,align);
+
+	if (aligned > base)
+		munmap(p,aligned-base);
+	if (align > aligned-base)
+		munmap(reinterpret_cast<void*>(aligned+bytes),align-(aligned-base));
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+void bindToNode(void* p,std::size_t bytes,int node)
+{
+	unsigned long mask[16]={0};
+	const unsigned bitsPerWord = sizeof(unsigned long)*CHAR_BIT;
+
+	if (node < 0 || unsigned(node) >= 16*bitsPerWord)
+		return;
+
+	mask[node/bitsPerWord] = 1UL << (node%bitsPerWord);
+	if (syscall(SYS_mbind,p,bytes,MPOL_BIND_,mask,16*bitsPerWord,0) != 0)
+		BLUELINK_TRACE(MbindFailed,node,errno);
+}
+
+}
+
+std::size_t page_bytes(const PageBacking b)
+{
+	switch(b)
+	{
+	case PageBacking::TransparentHuge:
+	case PageBacking::HugeTLB2M:	return THPBytes;
+	case PageBacking::HugeTLB1G:	return std::size_t(1)<<30;
+	default:						return sysconf(_SC_PAGESIZE);
+	}
+}
+
+void* pinned_alloc(std::size_t bytes,const PinnedAllocPolicy& policy)
+{
+	PageBacking backing = policy.backing;
+	const std::size_t pageBytes = page_bytes(backing);
+	bytes = roundUp(std::max(bytes,std::size_t(1)),pageBytes);
+
+	void* p=nullptr;
+
+	if (backing == PageBacking::HugeTLB2M || backing == PageBacking::HugeTLB1G)
+	{
+		int flags = MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB | ((backing == PageBacking::HugeTLB1G ? 30 : 21) << MAP_HUGE_SHIFT);
+		p = mmap(nullptr,bytes,PROT_READ|PROT_WRITE,flags,-1,0);
+
+		if (p == MAP_FAILED)
+		{
+			BLUELINK_TRACE(HugeTLBFailed,bytes,errno);
+			p=nullptr;
+		}
+	}
+
+	if (!p)
+	{
+		p = mapAligned(bytes,std::max(pageBytes,THPBytes));
+		if (backing != PageBacking::Default)
+			madvise(p,bytes,MADV_HUGEPAGE);
+	}
+
+	if (policy.numaNode >= 0)
+		bindToNode(p,bytes,policy.numaNode);
+
+	if (policy.prefaultThreads)
+		prefault(p,bytes,sysconf(_SC_PAGESIZE),policy.prefaultThreads);
+
+	// after the parallel prefault (if any), so mlock only has to pin pages that are already there
+	if (policy.lock && mlock(p,bytes) != 0)
+	{
+		const int err = errno;
+		if (lockFailures++ == 0 && !policy.requireLock)
+			BLUELINK_TRACE(MlockFailed,bytes,err);
+		if (policy.requireLock)
+		{
+			BLUELINK_TRACE(MlockRequired,bytes,err);
+			munmap(p,bytes);
+			throw std::bad_alloc();
+		}
+	}
+
+	return p;
+}
+
+unsigned long pinned_lock_failures()
+{
+	return lockFailures.load();
+}
+
+void pinned_free(void* p,std::size_t bytes,const PinnedAllocPolicy& policy)
+{
+	if (p)									// also unlocks
+		munmap(p,roundUp(std::max(bytes,std::size_t(1)),page_bytes(policy.backing)));
+}
+
+void prefault(void* p,const std::size_t bytes,const std::size_t pageBytes,unsigned nThreads,const bool write)
+{
+	const std::size_t Npages = (bytes+pageBytes-1)/pageBytes;
+	nThreads = std::max(1U,std::min<unsigned>(nThreads,Npages));
+
+	volatile char* c = static_cast<volatile char*>(p);
+
+	auto touch = [c,pageBytes,write](std::size_t i0,std::size_t i1)
+	{
+		for(std::size_t i=i0;i<i1;++i)
+			if (write)
+				c[i*pageBytes] = c[i*pageBytes];		// write touch so the page is faulted in writable
+			else
+				(void)c[i*pageBytes];
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nThreads);
+
+	for(unsigned t=0;t<nThreads;++t)
+		threads.emplace_back(touch,Npages*t/nThreads,Npages*(t+1)/nThreads);
+
+	for(auto& t : threads)
+		t.join();
+}
+
+int cxl_numa_node(const std::string& devstr)
+{
+	// /sys/class/cxl/afuX.Yd links into the PCI device tree (pci device -> cardX -> afuX.Y -> afuX.Yd); walk up to numa_node
+	std::string name = devstr.substr(devstr.find_last_of('/')+1);
+
+	char* real = realpath(("/sys/class/cxl/"+name).c_str(),nullptr);
+	if (!real)
+		return -1;
+
+	std::string path(real);
+	free(real);
+
+	for(std::size_t pos; (pos=path.find_last_of('/')) != std::string::npos && pos > 0; path.resize(pos))
+	{
+		ifstream is(path+"/numa_node");
+		int node;
+		if (is >> node)
+			return node;
+	}
+	return -1;
+}
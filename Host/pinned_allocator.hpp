@@ -0,0 +1,94 @@
+/*
+ * pinned_allocator.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef PINNED_ALLOCATOR_HPP_
+#define PINNED_ALLOCATOR_HPP_
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+/** Page backing for AFU-visible buffers. Larger pages mean far fewer PSL translation misses and page faults on big transfers.
+ *
+ * TransparentHuge uses an anonymous mapping aligned to 2M with madvise(MADV_HUGEPAGE); HugeTLB* need pages reserved in the
+ * hugetlbfs pool (/proc/sys/vm/nr_hugepages or hugepages= on the kernel command line). If a hugetlb mapping fails, allocation
+ * falls back to TransparentHuge with a warning.
+ *
+ * Buffers are locked into memory (mlock) so they can't be swapped or migrated while the AFU holds their addresses. Locking needs
+ * CAP_IPC_LOCK or a large enough RLIMIT_MEMLOCK (ulimit -l); if it fails the buffer is returned unlocked with a warning (once per
+ * process), unless requireLock is set, in which case allocation throws std::bad_alloc. pinned_lock_failures() counts the failures.
+ */
+
+enum class PageBacking { Default, TransparentHuge, HugeTLB2M, HugeTLB1G };
+
+struct PinnedAllocPolicy
+{
+	PageBacking	backing=PageBacking::TransparentHuge;
+	int			numaNode=-1;				// NUMA node to bind to (-1: no binding), see cxl_numa_node
+	unsigned	prefaultThreads=0;			// if nonzero, touch every page with this many threads before returning
+	bool		lock=true;					// mlock the buffer
+	bool		requireLock=false;			// throw std::bad_alloc rather than return an unlocked buffer
+};
+
+std::size_t page_bytes(PageBacking b);
+
+/// Allocates bytes (rounded up to the page size) according to the policy; page-aligned so always suitable for the AFU
+void* pinned_alloc(std::size_t bytes,const PinnedAllocPolicy& policy);
+void  pinned_free(void* p,std::size_t bytes,const PinnedAllocPolicy& policy);
+
+/// Number of allocations whose mlock failed (returned unlocked, or thrown if requireLock)
+unsigned long pinned_lock_failures();
+
+/// Touches every page of [p,p+bytes) using nThreads threads so the faults are taken up front rather than by the PSL
+/// (write touch unless write=false, eg. for read-only or copy-on-write mappings)
+void prefault(void* p,std::size_t bytes,std::size_t pageBytes,unsigned nThreads,bool write=true);
+
+/// NUMA node of the PCI device behind a cxl device string (eg. /dev/cxl/afu0.0d), or -1 if it can't be determined
+int cxl_numa_node(const std::string& devstr);
+
+
+
+/** STL allocator using pinned_alloc. Unlike aligned_allocator, it is stateful (carries the policy). */
+
+template<typename T>class pinned_allocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef T& reference;
+    typedef const T* const_pointer;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    pinned_allocator(){}
+    explicit pinned_allocator(const PinnedAllocPolicy& policy) : m_policy(policy){}
+    pinned_allocator(const pinned_allocator&) = default;
+    template<class U>pinned_allocator(const pinned_allocator<U>& u) : m_policy(u.policy()){}
+
+    template<typename U>struct rebind { typedef pinned_allocator<U> other; };
+
+    pointer allocate(size_type n)
+    {
+        return static_cast<T*>(pinned_alloc(n*sizeof(T),m_policy));
+    }
+
+    void deallocate(pointer p,size_type n)
+    {
+        pinned_free(p,n*sizeof(T),m_policy);
+    }
+
+    const PinnedAllocPolicy& policy() const { return m_policy; }
+
+    template<class U>bool operator==(const pinned_allocator<U>& rhs) const { return m_policy.backing == rhs.policy().backing; }
+    template<class U>bool operator!=(const pinned_allocator<U>& rhs) const { return !(*this == rhs); }
+
+private:
+    PinnedAllocPolicy m_policy;
+};
+
+#endif /* PINNED_ALLOCATOR_HPP_ */